@@ -1,5 +1,8 @@
 struct buf;
 struct context;
+struct cpu;
+struct schedstat;
+struct proctime;
 struct file;
 struct inode;
 struct pipe;
@@ -7,6 +10,8 @@ struct proc;
 struct rtcdate;
 struct spinlock;
 struct sleeplock;
+struct spawnaction;
+struct image;
 struct stat;
 struct superblock;
 struct reentrantlock;
@@ -27,6 +32,8 @@ int             find_length(int n);
 
 // exec.c
 int             exec(char*, char**);
+int             loaduser(char*, char**, struct image*);
+void            setimage(struct proc*, struct image*);
 
 // file.c
 struct file*    filealloc(void);
@@ -71,6 +78,8 @@ char*           kalloc(void);
 void            kfree(char*);
 void            kinit1(void*, void*);
 void            kinit2(void*, void*);
+void            kref(char*);
+int             krefs(char*);
 
 // kbd.c
 void            kbdintr(void);
@@ -80,8 +89,11 @@ void            cmostime(struct rtcdate *r);
 int             lapicid(void);
 extern volatile uint*    lapic;
 void            lapiceoi(void);
+void            lapicipi(int, int);
 void            lapicinit(void);
 void            lapicstartap(uchar, uint);
+void            tscinit(void);
+extern uint     tsc_per_us;
 void            microdelay(int);
 
 // log.c
@@ -124,14 +136,37 @@ void            userinit(void);
 int             wait(void);
 void            wakeup(void*);
 void            yield(void);
+int             timer_tick(struct cpu*, struct proc*);
+int             yield_to(int);
+void            gang_update(struct proc*);
+int             set_gang(int, int);
+int             gang_expired(struct proc*);
+int             gang_call(void);
+int             group_tick(struct proc*);
+int             set_group(int, int);
+int             set_group_quota(int, int, int);
+int             inherit_priority(struct proc*, struct proc*, int);
+void            end_inheritance(struct proc*);
+void            cond_resched(void);
+int             spawn(char*, char**, struct spawnaction*, int);
 void            create_palindrome(int);
 int             sort_syscalls(int);
 int             get_most_invoked_syscall(int);
 int             list_all_processes(void);
 int             change_queue(int,int);
-void            aging_process(int);
 void            print_processes_info(void);
 int             set_sjf_params(int, int, int);
+int             set_burst_prediction(int, int, int);
+int             window_end(struct cpu*, int);
+int             set_edf_params(int, int, int, int);
+int             edf_tick(struct proc*);
+int             set_affinity(int, uint);
+int             getschedstat(struct schedstat*);
+int             getcputime(int, struct proctime*);
+void            account(struct proc*, int);
+int             set_tickets(int, int);
+int             transfer_tickets(int, int);
+int             tune_scheduler(int, int, int, int, int, int, int);
 
 // swtch.S
 void            swtch(struct context**, struct context*);
@@ -179,6 +214,7 @@ void            timerinit(void);
 // trap.c
 void            idtinit(void);
 extern uint     ticks;
+extern uint     tsc_per_tick;
 void            tvinit(void);
 extern struct spinlock tickslock;
 
@@ -201,6 +237,10 @@ pde_t*          copyuvm(pde_t*, uint);
 void            switchuvm(struct proc*);
 void            switchkvm(void);
 int             copyout(pde_t*, uint, void*, uint);
+int             pagefault(uint);
+int             faultuvm(uint, uint);
+void            textinit(void);
+int             textreclaim(void);
 void            clearpteu(pde_t *pgdir, char *uva);
 void            inithial_shared_memory(void);
 extern void*    open_shared_memory(int);
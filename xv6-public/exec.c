@@ -7,17 +7,23 @@
 #include "x86.h"
 #include "elf.h"
 
+// Set up the program at path in a new page table, with argv on
+// its stack, filling in img with the page table, and the image
+// size, stack pointer and entry point to start it with, for
+// exec() and spawn().  The program's segments are not read in:
+// img records where they come from in the file, and pagefault()
+// reads each page in when it is first touched.  Segments beyond
+// the first NSEG are loaded now.
 int
-exec(char *path, char **argv)
+loaduser(char *path, char **argv, struct image *img)
 {
-  char *s, *last;
   int i, off;
   uint argc, sz, sp, ustack[3+MAXARG+1];
   struct elfhdr elf;
   struct inode *ip;
   struct proghdr ph;
-  pde_t *pgdir, *oldpgdir;
-  struct proc *curproc = myproc();
+  struct segment *seg;
+  pde_t *pgdir;
 
   begin_op();
 
@@ -28,7 +34,6 @@ exec(char *path, char **argv)
   }
   ilock(ip);
   pgdir = 0;
-  change_queue(myproc()->pid, UNSET);
 
   // Check ELF header
   if(readi(ip, (char*)&elf, 0, sizeof(elf)) != sizeof(elf))
@@ -39,8 +44,9 @@ exec(char *path, char **argv)
   if((pgdir = setupkvm()) == 0)
     goto bad;
 
-  // Load program into memory.
+  // Record the program's segments.
   sz = 0;
+  img->nseg = 0;
   for(i=0, off=elf.phoff; i<elf.phnum; i++, off+=sizeof(ph)){
     if(readi(ip, (char*)&ph, off, sizeof(ph)) != sizeof(ph))
       goto bad;
@@ -48,15 +54,27 @@ exec(char *path, char **argv)
       continue;
     if(ph.memsz < ph.filesz)
       goto bad;
-    if(ph.vaddr + ph.memsz < ph.vaddr)
-      goto bad;
-    if((sz = allocuvm(pgdir, sz, ph.vaddr + ph.memsz)) == 0)
+    if(ph.vaddr + ph.memsz < ph.vaddr || ph.vaddr + ph.memsz >= KERNBASE)
       goto bad;
     if(ph.vaddr % PGSIZE != 0)
       goto bad;
-    if(loaduvm(pgdir, (char*)ph.vaddr, ip, ph.off, ph.filesz) < 0)
-      goto bad;
+    if(img->nseg < NSEG){
+      seg = &img->seg[img->nseg++];
+      seg->va = ph.vaddr;
+      seg->memsz = ph.memsz;
+      seg->off = ph.off;
+      seg->filesz = ph.filesz;
+      seg->flags = ph.flags;
+    } else {
+      if(allocuvm(pgdir, ph.vaddr, ph.vaddr + ph.memsz) == 0)
+        goto bad;
+      if(loaduvm(pgdir, (char*)ph.vaddr, ip, ph.off, ph.filesz) < 0)
+        goto bad;
+    }
+    if(ph.vaddr + ph.memsz > sz)
+      sz = ph.vaddr + ph.memsz;
   }
+  img->exe = idup(ip);
   iunlockput(ip);
   end_op();
   ip = 0;
@@ -88,6 +106,52 @@ exec(char *path, char **argv)
   if(copyout(pgdir, sp, ustack, (3+argc+1)*4) < 0)
     goto bad;
 
+  img->pgdir = pgdir;
+  img->sz = sz;
+  img->sp = sp;
+  img->entry = elf.entry;
+  return 0;
+
+ bad:
+  if(pgdir)
+    freevm(pgdir);
+  if(ip){
+    iunlockput(ip);
+    end_op();
+  } else {
+    begin_op();
+    iput(img->exe);
+    end_op();
+  }
+  return -1;
+}
+
+// Make img p's program.
+void
+setimage(struct proc *p, struct image *img)
+{
+  int i;
+
+  p->pgdir = img->pgdir;
+  p->sz = img->sz;
+  p->exe = img->exe;
+  p->nseg = img->nseg;
+  for(i = 0; i < img->nseg; i++)
+    p->seg[i] = img->seg[i];
+}
+
+int
+exec(char *path, char **argv)
+{
+  char *s, *last;
+  struct image img;
+  struct inode *oldexe;
+  pde_t *oldpgdir;
+  struct proc *curproc = myproc();
+
+  if(loaduser(path, argv, &img) < 0)
+    return -1;
+
   // Save program name for debugging.
   for(last=s=path; *s; s++)
     if(*s == '/')
@@ -102,21 +166,18 @@ exec(char *path, char **argv)
 
   // Commit to the user image.
   oldpgdir = curproc->pgdir;
-  curproc->pgdir = pgdir;
-  curproc->sz = sz;
-  curproc->tf->eip = elf.entry;  // main
-  curproc->tf->esp = sp;
+  oldexe = curproc->exe;
+  setimage(curproc, &img);
+  curproc->tf->eip = img.entry;  // main
+  curproc->tf->esp = img.sp;
   switchuvm(curproc);
   freevm(oldpgdir);
-  // change_queue(myproc()->pid, UNSET);
-  return 0;
-
- bad:
-  if(pgdir)
-    freevm(pgdir);
-  if(ip){
-    iunlockput(ip);
+  if(oldexe){
+    begin_op();
+    iput(oldexe);
     end_op();
   }
-  return -1;
+  // Start over at the top level, under the new name.
+  change_queue(myproc()->pid, UNSET);
+  return 0;
 }
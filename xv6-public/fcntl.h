@@ -2,3 +2,13 @@
 #define O_WRONLY  0x001
 #define O_RDWR    0x002
 #define O_CREATE  0x200
+
+// spawn() actions on the child's file descriptors, in order.
+#define SPAWN_CLOSE 1     // close fd
+#define SPAWN_DUP2  2     // make newfd refer to fd's file
+
+struct spawnaction {
+  int op;
+  int fd;
+  int newfd;
+};
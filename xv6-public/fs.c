@@ -166,8 +166,20 @@ bfree(int dev, uint b)
 struct {
   struct spinlock lock;
   struct inode inode[NINODE];
+  uint gen;                     // Last inode generation given out
 } icache;
 
+// Give ip a generation no inode has had, as its contents are
+// read in or about to change, so that pages of it that pagein()
+// cached under the old one are not used again.
+static void
+inewgen(struct inode *ip)
+{
+  acquire(&icache.lock);
+  ip->gen = ++icache.gen;
+  release(&icache.lock);
+}
+
 void
 iinit(int dev)
 {
@@ -306,6 +318,7 @@ ilock(struct inode *ip)
     memmove(ip->addrs, dip->addrs, sizeof(ip->addrs));
     brelse(bp);
     ip->valid = 1;
+    inewgen(ip);
     if(ip->type == 0)
       panic("ilock: no type");
   }
@@ -424,6 +437,7 @@ itrunc(struct inode *ip)
     for(j = 0; j < NINDIRECT; j++){
       if(a[j])
         bfree(ip->dev, a[j]);
+      cond_resched();
     }
     brelse(bp);
     bfree(ip->dev, ip->addrs[NDIRECT]);
@@ -471,6 +485,7 @@ readi(struct inode *ip, char *dst, uint off, uint n)
     m = min(n - tot, BSIZE - off%BSIZE);
     memmove(dst, bp->data + off%BSIZE, m);
     brelse(bp);
+    cond_resched();
   }
   return n;
 }
@@ -495,12 +510,15 @@ writei(struct inode *ip, char *src, uint off, uint n)
   if(off + n > MAXFILE*BSIZE)
     return -1;
 
+  if(n > 0)
+    inewgen(ip);
   for(tot=0; tot<n; tot+=m, off+=m, src+=m){
     bp = bread(ip->dev, bmap(ip, off/BSIZE));
     m = min(n - tot, BSIZE - off%BSIZE);
     memmove(bp->data + off%BSIZE, src, m);
     log_write(bp);
     brelse(bp);
+    cond_resched();
   }
 
   if(n > 0 && off > ip->size){
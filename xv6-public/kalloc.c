@@ -17,10 +17,14 @@ struct run {
   struct run *next;
 };
 
+// ref[] counts the page tables mapping each physical page, so
+// that pages shared copy-on-write after fork() are freed with
+// their last mapping.  A page from kalloc() starts at 1.
 struct {
   struct spinlock lock;
   int use_lock;
   struct run *freelist;
+  uchar ref[PHYSTOP / PGSIZE];
 } kmem;
 
 // Initialization happens in two phases.
@@ -52,10 +56,10 @@ freerange(void *vstart, void *vend)
     kfree(p);
 }
 //PAGEBREAK: 21
-// Free the page of physical memory pointed at by v,
-// which normally should have been returned by a
-// call to kalloc().  (The exception is when
-// initializing the allocator; see kinit above.)
+// Drop a reference to the page of physical memory pointed at
+// by v, which normally should have been returned by a call to
+// kalloc(), and free it if that was the last.  (The exception
+// is when initializing the allocator; see kinit above.)
 void
 kfree(char *v)
 {
@@ -64,6 +68,18 @@ kfree(char *v)
   if((uint)v % PGSIZE || v < end || V2P(v) >= PHYSTOP)
     panic("kfree");
 
+  if(kmem.use_lock)
+    acquire(&kmem.lock);
+  if(kmem.ref[V2P(v) / PGSIZE] > 1){
+    kmem.ref[V2P(v) / PGSIZE]--;
+    if(kmem.use_lock)
+      release(&kmem.lock);
+    return;
+  }
+  kmem.ref[V2P(v) / PGSIZE] = 0;
+  if(kmem.use_lock)
+    release(&kmem.lock);
+
   // Fill with junk to catch dangling refs.
   memset(v, 1, PGSIZE);
 
@@ -87,10 +103,42 @@ kalloc(void)
   if(kmem.use_lock)
     acquire(&kmem.lock);
   r = kmem.freelist;
-  if(r)
+  if(r == 0 && kmem.use_lock){
+    // Give back program pages kept only by the text cache.
+    release(&kmem.lock);
+    textreclaim();
+    acquire(&kmem.lock);
+    r = kmem.freelist;
+  }
+  if(r){
     kmem.freelist = r->next;
+    kmem.ref[V2P(r) / PGSIZE] = 1;
+  }
   if(kmem.use_lock)
     release(&kmem.lock);
   return (char*)r;
 }
 
+// Add a reference to the page at v, now mapped once more.
+void
+kref(char *v)
+{
+  acquire(&kmem.lock);
+  if(kmem.ref[V2P(v) / PGSIZE] == 0xFF)
+    panic("kref");
+  kmem.ref[V2P(v) / PGSIZE]++;
+  release(&kmem.lock);
+}
+
+// The number of references to the page at v.
+int
+krefs(char *v)
+{
+  int n;
+
+  acquire(&kmem.lock);
+  n = kmem.ref[V2P(v) / PGSIZE];
+  release(&kmem.lock);
+  return n;
+}
+
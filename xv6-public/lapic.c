@@ -120,6 +120,51 @@ microdelay(int us)
 {
 }
 
+uint tsc_per_us = 1;   // TSC cycles per microsecond, set by tscinit()
+
+#define PIT_CH2   0x42       // 8253 PIT channel 2 data
+#define PIT_CMD   0x43       // PIT mode/command
+#define PIT_GATE  0x61       // Port B: channel 2 gate and output
+#define PIT_HZ    1193182
+
+// Time 10 ms of PIT channel 2, which counts at PIT_HZ whatever
+// the CPU speed, with the TSC to learn the TSC rate.
+void
+tscinit(void)
+{
+  uint latch = PIT_HZ / 100;
+  uint64 t0, t1;
+
+  outb(PIT_GATE, (inb(PIT_GATE) & ~0x02) | 0x01);  // gate on, speaker off
+  outb(PIT_CMD, 0xB0);  // channel 2, lo/hi byte, one-shot
+  outb(PIT_CH2, latch & 0xFF);
+  outb(PIT_CH2, latch >> 8);
+  t0 = rdtsc();
+  while((inb(PIT_GATE) & 0x20) == 0)
+    ;
+  t1 = rdtsc();
+  tsc_per_us = (uint)(t1 - t0) / 10000;
+  if(tsc_per_us == 0)
+    tsc_per_us = 1;
+}
+
+// Send a fixed interrupt with the given vector to the
+// CPU whose local APIC ID is apicid.
+void
+lapicipi(int apicid, int vector)
+{
+  if(!lapic)
+    return;
+  // An interrupt handler on this CPU could send an IPI of
+  // its own between the two ICR writes.
+  pushcli();
+  lapicw(ICRHI, apicid<<24);
+  lapicw(ICRLO, FIXED | ASSERT | vector);
+  while(lapic[ICRLO] & DELIVS)
+    ;
+  popcli();
+}
+
 #define CMOS_PORT    0x70
 #define CMOS_RETURN  0x71
 
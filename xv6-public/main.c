@@ -19,8 +19,10 @@ main(void)
 {
   kinit1(end, P2V(4*1024*1024)); // phys page allocator
   kvmalloc();      // kernel page table
+  textinit();      // shared program pages
   mpinit();        // detect other processors
   lapicinit();     // interrupt controller
+  tscinit();       // TSC rate
   seginit();       // segment descriptors
   picinit();       // disable pic
   ioapicinit();    // another interrupt controller
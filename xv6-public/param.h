@@ -11,4 +11,7 @@
 #define LOGSIZE      (MAXOPBLOCKS*3)  // max data blocks in on-disk log
 #define NBUF         (MAXOPBLOCKS*3)  // size of disk block cache
 #define FSSIZE       1000  // size of file system in blocks
+#define NSEG          4  // program segments paged in on demand per process
+#define PAGEIN_AHEAD  3  // pages read ahead of a faulting program page
+#define NTEXTPAGE   256  // program pages cached for sharing between processes
 
@@ -7,6 +7,9 @@
 #include "proc.h"
 #include "spinlock.h"
 #include "syscall.h"
+#include "traps.h"
+#include "schedstat.h"
+#include "fcntl.h"
 #include <stddef.h>
 
 struct {
@@ -14,6 +17,127 @@ struct {
   struct proc proc[NPROC];
 } ptable;
 
+// Ready list threaded through struct proc (rq_next/rq_prev).
+struct readylist {
+  struct proc *head;
+  struct proc *tail;
+};
+
+// Binary min-heap of ready processes ordered by less():
+// SJF on sjf.BurstTime, STRIDE on stride.pass, EDF on
+// edf.deadline_at.
+// p->heap_index is p's slot in proc[].
+struct procheap {
+  struct proc *proc[NPROC];
+  int size;
+  int (*less)(struct proc*, struct proc*);
+};
+
+// Timer wheel of queued SJF and FCFS processes, bucketed by
+// age_expiry % AGING_WHEEL, so aging only visits the processes
+// whose deadline falls on the ticks that have passed.
+struct agingwheel {
+  struct proc *slot[AGING_WHEEL];
+  uint now;                    // Last tick processed
+};
+
+// Per-CPU run queues, one ready list per scheduling class.
+// A run queue's lock protects the state of the processes that
+// belong to it (p->cpu) and is held across swtch() into and out
+// of them; ptable.lock only guards process creation, exit and
+// lookup by pid, so context switches on different CPUs do not
+// contend with each other.
+// ROUND_ROBIN and FCFS use intrusive lists whose head is always
+// the next process to run; SJF uses a heap on burst time,
+// STRIDE one on pass and EDF one on deadline.  EDF processes
+// waiting for their next release sit on list[EDF] and are not
+// counted as runnable.  EDF processes are admitted against, and
+// stay on, one run queue.
+struct runqueue {
+  struct spinlock lock;
+  struct readylist list[NQUEUE];
+  struct procheap sjf;
+  struct procheap stride;
+  struct procheap edf;
+  uint stride_pass;            // Pass of the last STRIDE process run
+  uint mlfq_epoch;             // Reset period last swept
+  struct proc *gang_next;      // Gang member to run next
+  int gang_next_gang;          // ...and the gang it was called for
+  struct readylist throttled;  // Queued members of groups out of quota
+  struct schedhist hist[SCHED_NCLASS];  // Latencies by class
+  int edf_util;                // Admitted EDF utilization, per mille
+  int count[NQUEUE];
+  int nrunnable;
+  uint seed;                   // xorshift state for SJF confidence draws
+  struct agingwheel aging;
+};
+
+struct runqueue runqueues[NCPU];
+
+// Processes in sleep(), hashed on their wait channel so that
+// wakeup() only looks at those that may be waiting on its
+// channel.  A sleeper links itself in before it sleeps and
+// unlinks itself once awake, so the lists can hold processes
+// that were woken but have not run yet; wakeup() checks state
+// and chan under the process's run queue lock as before.
+// Lock order: the sleeper's lk, then a wait queue, then a run
+// queue.
+struct waitqueue {
+  struct spinlock lock;
+  struct proc *head;
+};
+
+struct waitqueue waitqueues[NWAITQ];
+
+// Gang scheduling.  Processes attached to a shared memory region
+// with gang scheduling turned on form the gang numbered by the
+// region's mem_id.  Dispatching a member outside a slot opens a
+// slot of rr_quantum ticks and calls, by IPI, the other CPUs on
+// whose run queues members are waiting, up to one per other
+// member.  Each called CPU runs a queued member next, pulling
+// one over from another CPU if it has none by then.
+// When the slot is over every member is preempted at its next
+// tick, so the gang runs, and stops, together instead of
+// spinning on partners that are not running.
+// Lock order: run queue, then gangs.lock.
+struct gang {
+  int enabled;
+  int nmembers;
+  uint slot_end;               // Tick the current slot ends
+  uint slots;                  // Slots opened
+  uint joins;                  // Members dispatched into an open slot
+  uint pulls;                  // Members pulled to a called CPU
+  uint preempts;               // Members preempted at the end of a slot
+};
+
+struct {
+  struct spinlock lock;
+  struct gang gang[NUM_SHARED_MEMORY];
+} gangs;
+
+// CPU bandwidth quotas.  Every process belongs to a group,
+// inherited across fork(); group 0 is unlimited.  A group with a
+// quota may use quota_ms of CPU time, on all CPUs together, in
+// each period of period_ms.  account() charges the time; once it
+// is used up the running member is preempted at its next tick
+// and members becoming runnable wait on their run queue's
+// throttled list, uncounted, until the next period starts.
+// EDF processes are held to their own budgets instead.
+// Lock order: run queue, then groups.lock.
+struct group {
+  int quota_ms;                // 0 for no quota
+  int period_ms;
+  uint64 period_start;         // TSC at the start of the current period
+  uint used_us;                // CPU time used in the current period
+  int throttled;               // Has the current period's quota run out?
+  uint nthrottled;             // Periods in which the quota ran out
+};
+
+struct {
+  struct spinlock lock;
+  struct group group[NGROUP];
+} groups;
+
 static struct proc *initproc;
 
 int nextpid = 1;
@@ -21,11 +145,38 @@ extern void forkret(void);
 extern void trapret(void);
 
 static void wakeup1(void *chan);
+static int sjf_less(struct proc*, struct proc*);
+static int stride_less(struct proc*, struct proc*);
+static int edf_less(struct proc*, struct proc*);
+static int window_class(struct cpu*, int);
 
 void
 pinit(void)
 {
+  struct runqueue *rq;
+  struct waitqueue *wq;
+  struct cpu *c;
+
   initlock(&ptable.lock, "ptable");
+  initlock(&gangs.lock, "gangs");
+  initlock(&groups.lock, "groups");
+  for(wq = waitqueues; wq < &waitqueues[NWAITQ]; wq++)
+    initlock(&wq->lock, "waitqueue");
+  for(rq = runqueues; rq < &runqueues[NCPU]; rq++){
+    initlock(&rq->lock, "runqueue");
+    rq->sjf.less = sjf_less;
+    rq->stride.less = stride_less;
+    rq->edf.less = edf_less;
+  }
+  for(c = cpus; c < &cpus[NCPU]; c++){
+    c->tune.period = SCHED_PERIOD;
+    c->tune.share[ROUND_ROBIN] = RR_SHARE;
+    c->tune.share[SJF] = SJF_SHARE;
+    c->tune.share[FCFS] = FCFS_SHARE;
+    c->tune.share[STRIDE] = STRIDE_SHARE;
+    c->tune.rr_quantum = RR_QUANTUM;
+    c->tune.aging_threshold = AGING_THRESHOLD;
+  }
 }
 
 // Must be called with interrupts disabled
@@ -67,6 +218,662 @@ myproc(void) {
   return p;
 }
 
+// Lock and return the current CPU's run queue.
+static struct runqueue*
+acquirerq(void)
+{
+  struct runqueue *rq;
+
+  pushcli();
+  rq = &runqueues[cpuid()];
+  acquire(&rq->lock);
+  popcli();
+  return rq;
+}
+
+// Release the run queue lock of the CPU we are running on now,
+// which after a swtch() need not be the one we locked before it.
+static void
+releaserq(void)
+{
+  release(&runqueues[cpuid()].lock);
+}
+
+// Lock and return the run queue p belongs to.  p->cpu only
+// changes while that run queue is locked, so check it again
+// once the lock is held.
+static struct runqueue*
+acquireprocrq(struct proc *p)
+{
+  struct runqueue *rq;
+
+  for(;;){
+    rq = &runqueues[p->cpu];
+    acquire(&rq->lock);
+    if(rq == &runqueues[p->cpu])
+      return rq;
+    release(&rq->lock);
+  }
+}
+
+// Link p into l after prev, or at the head if prev is 0.
+static void
+list_insert(struct readylist *l, struct proc *prev, struct proc *p)
+{
+  p->rq_prev = prev;
+  p->rq_next = prev ? prev->rq_next : l->head;
+  if(p->rq_next)
+    p->rq_next->rq_prev = p;
+  else
+    l->tail = p;
+  if(prev)
+    prev->rq_next = p;
+  else
+    l->head = p;
+}
+
+static void
+list_remove(struct readylist *l, struct proc *p)
+{
+  if(p->rq_prev)
+    p->rq_prev->rq_next = p->rq_next;
+  else
+    l->head = p->rq_next;
+  if(p->rq_next)
+    p->rq_next->rq_prev = p->rq_prev;
+  else
+    l->tail = p->rq_prev;
+  p->rq_next = p->rq_prev = 0;
+}
+
+static int
+sjf_less(struct proc *a, struct proc *b)
+{
+  return a->sched_info.sjf.BurstTime < b->sched_info.sjf.BurstTime;
+}
+
+// Passes wrap around; compare them by their difference.
+static int
+stride_less(struct proc *a, struct proc *b)
+{
+  return (int)(a->sched_info.stride.pass - b->sched_info.stride.pass) < 0;
+}
+
+static int
+edf_less(struct proc *a, struct proc *b)
+{
+  return (int)(a->sched_info.edf.deadline_at - b->sched_info.edf.deadline_at) < 0;
+}
+
+static void
+heap_swap(struct procheap *h, int i, int j)
+{
+  struct proc *t = h->proc[i];
+
+  h->proc[i] = h->proc[j];
+  h->proc[j] = t;
+  h->proc[i]->heap_index = i;
+  h->proc[j]->heap_index = j;
+}
+
+static void
+heap_siftup(struct procheap *h, int i)
+{
+  while(i > 0 && h->less(h->proc[i], h->proc[(i - 1) / 2])){
+    heap_swap(h, i, (i - 1) / 2);
+    i = (i - 1) / 2;
+  }
+}
+
+static void
+heap_siftdown(struct procheap *h, int i)
+{
+  int min, c;
+
+  for(;;){
+    min = i;
+    for(c = 2*i + 1; c <= 2*i + 2 && c < h->size; c++)
+      if(h->less(h->proc[c], h->proc[min]))
+        min = c;
+    if(min == i)
+      return;
+    heap_swap(h, i, min);
+    i = min;
+  }
+}
+
+static void
+heap_push(struct procheap *h, struct proc *p)
+{
+  p->heap_index = h->size;
+  h->proc[h->size++] = p;
+  heap_siftup(h, p->heap_index);
+}
+
+static void
+heap_remove(struct procheap *h, struct proc *p)
+{
+  int i = p->heap_index;
+
+  if(i < 0 || i >= h->size || h->proc[i] != p)
+    panic("heap_remove");
+  h->size--;
+  if(i != h->size){
+    h->proc[i] = h->proc[h->size];
+    h->proc[i]->heap_index = i;
+    heap_siftdown(h, i);
+    heap_siftup(h, i);
+  }
+  p->heap_index = -1;
+}
+
+// The ready heap of class q, or 0 if q uses a list.
+static struct procheap*
+rq_heap(struct runqueue *rq, int q)
+{
+  switch(q){
+  case SJF:
+    return &rq->sjf;
+  case STRIDE:
+    return &rq->stride;
+  case EDF:
+    return &rq->edf;
+  }
+  return 0;
+}
+
+// Bring p's EDF job up to date: once its period is over, release
+// the next job with a fresh budget, counting a miss if the old
+// one never ended.  Returns 1 if a job was released.
+static int
+edf_advance(struct proc *p, uint now)
+{
+  struct edf_info *e = &p->sched_info.edf;
+
+  if(now - e->release < e->period)
+    return 0;
+  if(!e->done)
+    e->misses++;
+  e->release += (now - e->release) / e->period * e->period;
+  e->deadline_at = e->release + e->deadline;
+  e->budget = e->runtime;
+  e->done = 0;
+  e->jobs++;
+  return 1;
+}
+
+// Arm p's aging timer: it is promoted once it has waited more
+// than threshold ticks since it last ran.  A deadline that has
+// already passed fires on the next tick processed.
+static void
+aging_insert(struct agingwheel *w, struct proc *p, int threshold)
+{
+  struct proc **slot;
+
+  p->age_expiry = p->sched_info.last_run + threshold + 1;
+  if((int)(p->age_expiry - w->now) <= 0)
+    p->age_expiry = w->now + 1;
+  slot = &w->slot[p->age_expiry % AGING_WHEEL];
+  p->age_prev = 0;
+  p->age_next = *slot;
+  if(*slot)
+    (*slot)->age_prev = p;
+  *slot = p;
+}
+
+static void
+aging_remove(struct agingwheel *w, struct proc *p)
+{
+  if(p->age_prev)
+    p->age_prev->age_next = p->age_next;
+  else
+    w->slot[p->age_expiry % AGING_WHEEL] = p->age_next;
+  if(p->age_next)
+    p->age_next->age_prev = p->age_prev;
+  p->age_next = p->age_prev = 0;
+}
+
+// Start a new period if g's current one is over.  Periods start
+// on multiples of the period unless at least one went by unused.
+// groups.lock must be held.
+static void
+group_refill(struct group *g, uint64 now)
+{
+  uint64 period = (uint64)g->period_ms * 1000 * tsc_per_us;
+
+  if(g->quota_ms == 0 || now - g->period_start < period)
+    return;
+  if(now - g->period_start >= 2 * period)
+    g->period_start = now;
+  else
+    g->period_start += period;
+  g->used_us = 0;
+  g->throttled = 0;
+}
+
+// Has group gid used up its quota for the current period?
+static int
+group_over(int gid)
+{
+  struct group *g = &groups.group[gid];
+  int over;
+
+  if(gid == 0)
+    return 0;
+  acquire(&groups.lock);
+  group_refill(g, rdtsc());
+  over = g->quota_ms > 0 && g->used_us >= (uint)g->quota_ms * 1000;
+  if(over && !g->throttled){
+    g->throttled = 1;
+    g->nthrottled++;
+  }
+  release(&groups.lock);
+  return over;
+}
+
+// Add p to the ready list of its scheduling class.
+// ROUND_ROBIN appends at the tail.  FCFS keeps its list ordered
+// by arrival_queue_time; the search starts at the tail, where a
+// newly arrived process belongs, so it is usually one step.
+// A STRIDE process that fell behind the run queue's pass while
+// it was blocked or elsewhere starts from that pass, so it
+// cannot make up for the time it did not want.  An EDF process
+// waking before the deadline of a job it ended resumes that job
+// with what is left of its budget; otherwise, and once the
+// budget is gone, it waits on list[EDF] for its next release.
+// A member of a group out of quota waits on rq->throttled.
+// rq->lock must be held.
+static void
+rq_enqueue(struct runqueue *rq, struct proc *p)
+{
+  int q = p->sched_info.queue;
+  struct edf_info *e = &p->sched_info.edf;
+  struct proc *prev;
+
+  if(q != EDF && group_over(p->group)){
+    list_insert(&rq->throttled, rq->throttled.tail, p);
+    p->throttled = 1;
+    p->on_rq = 1;
+    return;
+  }
+  switch(q){
+  case EDF:
+    edf_advance(p, ticks);
+    if(e->done && e->budget > 0 && (int)(ticks - e->deadline_at) < 0)
+      e->done = 0;
+    if(e->done || e->budget <= 0){
+      e->budget = 0;
+      list_insert(&rq->list[EDF], rq->list[EDF].tail, p);
+      p->on_rq = 1;
+      return;
+    }
+    heap_push(&rq->edf, p);
+    break;
+  case ROUND_ROBIN:
+    list_insert(&rq->list[q], rq->list[q].tail, p);
+    break;
+  case FCFS:
+    prev = rq->list[q].tail;
+    while(prev && prev->sched_info.arrival_queue_time > p->sched_info.arrival_queue_time)
+      prev = prev->rq_prev;
+    list_insert(&rq->list[q], prev, p);
+    break;
+  case STRIDE:
+    if((int)(p->sched_info.stride.pass - rq->stride_pass) < 0)
+      p->sched_info.stride.pass = rq->stride_pass;
+    // fall through
+  case SJF:
+    heap_push(rq_heap(rq, q), p);
+    break;
+  default:
+    panic("rq_enqueue");
+  }
+  if(q == SJF || q == FCFS)
+    aging_insert(&rq->aging, p, cpus[rq - runqueues].tune.aging_threshold);
+  rq->count[q]++;
+  rq->nrunnable++;
+  p->on_rq = 1;
+}
+
+// Unlink p from its ready list.  rq->lock must be held.
+static void
+rq_dequeue(struct runqueue *rq, struct proc *p)
+{
+  int q = p->sched_info.queue;
+
+  if(p->throttled){
+    list_remove(&rq->throttled, p);
+    p->throttled = 0;
+    p->on_rq = 0;
+    return;
+  }
+  if(q == EDF && p->heap_index < 0){
+    list_remove(&rq->list[EDF], p);
+    p->on_rq = 0;
+    return;
+  }
+  if(rq_heap(rq, q))
+    heap_remove(rq_heap(rq, q), p);
+  else
+    list_remove(&rq->list[q], p);
+  if(q == SJF || q == FCFS)
+    aging_remove(&rq->aging, p);
+  rq->count[q]--;
+  rq->nrunnable--;
+  p->on_rq = 0;
+}
+
+// Whether queued p may be dispatched now: neither throttled by
+// its group's quota nor, under EDF, waiting for its next period.
+// rq->lock must be held.
+static int
+queued_ready(struct proc *p)
+{
+  return p->on_rq && !p->throttled &&
+         (p->sched_info.queue != EDF || p->heap_index >= 0);
+}
+
+// p is giving up the CPU: fold the burst it just ran, from
+// dispatch until now, into its predicted burst and let SJF
+// order it on the new estimate.  A STRIDE process is charged
+// its stride for every tick of the burst, and at least one.
+// p must not be queued.
+static void
+end_burst(struct proc *p)
+{
+  struct sjf_info *sjf = &p->sched_info.sjf;
+  int burst = ticks - p->sched_info.get_cpu_time;
+  uint64 cycles = rdtsc() - p->sched_info.running_tsc;
+  uint hundredths;
+
+  // Measure the burst in 1/100 ticks with the TSC once the tick
+  // length is known; ticks alone round short bursts to 0 or 1.
+  if(tsc_per_tick >= 100)
+    hundredths = (cycles > 0xFFFFFFFF ? 0xFFFFFFFF : (uint)cycles) / (tsc_per_tick / 100);
+  else
+    hundredths = burst * 100;
+  if(hundredths > 1000000)
+    hundredths = 1000000;
+  sjf->predicted = (sjf->alpha * hundredths +
+                    (100 - sjf->alpha) * sjf->predicted) / 100;
+  if(sjf->auto_burst)
+    sjf->BurstTime = (sjf->predicted + 50) / 100;
+  if(p->sched_info.queue == STRIDE)
+    p->sched_info.stride.pass += p->sched_info.stride.stride * (burst > 0 ? burst : 1);
+}
+
+// p is blocking, which ends its current EDF job.  Count a miss
+// if it ended after its deadline.  p's run queue lock must be held.
+static void
+end_job(struct proc *p)
+{
+  struct edf_info *e = &p->sched_info.edf;
+
+  if(p->sched_info.queue != EDF || e->done)
+    return;
+  e->done = 1;
+  if((int)(ticks - e->deadline_at) > 0)
+    e->misses++;
+}
+
+// Is p subject to MLFQ level changes?
+static int
+mlfq_managed(struct proc *p)
+{
+  int q = p->sched_info.queue;
+
+  return q >= ROUND_ROBIN && q <= FCFS && !p->sched_info.pinned &&
+         p->sched_info.nboost == 0;
+}
+
+// Ticks a process may run at level q before it is moved down:
+// the ROUND_ROBIN quantum, doubled at each level below.
+static int
+mlfq_slice(struct cpu *c, int q)
+{
+  return c->tune.rr_quantum << (q - ROUND_ROBIN);
+}
+
+// Move unqueued p up (dir -1) or down (dir 1) a level.
+static void
+mlfq_move(struct proc *p, int dir)
+{
+  p->sched_info.queue += dir;
+  p->sched_info.arrival_queue_time = ticks;
+  if(dir < 0)
+    p->sched_info.promotions++;
+  else
+    p->sched_info.demotions++;
+}
+
+// p is about to be queued: if a reset period began since it was
+// last moved to the top, move it there now.  p must not be queued.
+static void
+mlfq_refresh(struct proc *p)
+{
+  uint epoch = ticks / MLFQ_RESET;
+
+  if(!mlfq_managed(p) || p->sched_info.mlfq_epoch == epoch)
+    return;
+  p->sched_info.mlfq_epoch = epoch;
+  if(p->sched_info.queue != ROUND_ROBIN){
+    p->sched_info.queue = ROUND_ROBIN;
+    p->sched_info.arrival_queue_time = ticks;
+    p->sched_info.promotions++;
+  }
+}
+
+// Recompute p's stride from the tickets it holds, its own less
+// those lent out plus those borrowed.  p's run queue lock must
+// be held.
+static void
+set_stride(struct proc *p)
+{
+  struct stride_info *s = &p->sched_info.stride;
+  int tickets = s->tickets - s->lent + s->borrowed;
+
+  if(tickets < 1)
+    tickets = 1;
+  s->stride = STRIDE1 / tickets;
+}
+
+// Give p's lent tickets back.  ptable.lock must be held.
+static void
+end_loan(struct proc *p)
+{
+  struct stride_info *s = &p->sched_info.stride;
+  struct runqueue *rq;
+
+  if(s->lent_to == 0)
+    return;
+  rq = acquireprocrq(s->lent_to);
+  s->lent_to->sched_info.stride.borrowed -= s->lent;
+  set_stride(s->lent_to);
+  release(&rq->lock);
+
+  rq = acquireprocrq(p);
+  s->lent_to = 0;
+  s->lent = 0;
+  set_stride(p);
+  release(&rq->lock);
+}
+
+// p was just queued on rq.  If rq's CPU is halted, wake it;
+// otherwise wake some other halted CPU that p's affinity allows,
+// so that it can steal p.  EDF processes are never stolen.
+// The enqueue is published before c->idle is read, pairing with
+// idle(), which sets c->idle before it checks for work.
+static void
+kickcpu(struct runqueue *rq, struct proc *p)
+{
+  struct cpu *c = &cpus[rq - runqueues];
+
+  __sync_synchronize();
+  if(!c->idle){
+    if(p->sched_info.queue == EDF)
+      return;
+    for(c = cpus; c < cpus+ncpu; c++)
+      if(c->idle && (p->affinity & (1 << (c - cpus))))
+        break;
+  }
+  if(c < cpus+ncpu)
+    lapicipi(c->apicid, T_IRQ0 + IRQ_RESCHED);
+}
+
+// Count cycles in bucket floor(log2(cycles)) of h.
+static void
+hist_add(uint *h, uint64 cycles)
+{
+  int b = 0;
+
+  while((cycles >>= 1) != 0 && b < SCHED_NBUCKET - 1)
+    b++;
+  h[b]++;
+}
+
+// Charge p for the CPU time since it was last charged, to its
+// user time if it has been in user mode.  Called on trap entry
+// and exit and when p is switched in and out.
+void
+account(struct proc *p, int user)
+{
+  struct cputime *t = user ? &p->sched_info.utime : &p->sched_info.stime;
+  uint64 now = rdtsc();
+  uint64 d = now - p->sched_info.acct_tsc;
+  uint cycles, us;
+
+  p->sched_info.acct_tsc = now;
+  // Charge points are never more than a tick apart.
+  if(d > 0x7FFFFFFF)
+    d = 0x7FFFFFFF;
+  cycles = t->cycles + (uint)d;
+  us = cycles / tsc_per_us;
+  t->usec += us;
+  t->cycles = cycles % tsc_per_us;
+  if(p->group != 0 && us > 0){
+    acquire(&groups.lock);
+    group_refill(&groups.group[p->group], now);
+    groups.group[p->group].used_us += us;
+    release(&groups.lock);
+  }
+  while(t->usec >= 1000000){
+    t->usec -= 1000000;
+    t->sec++;
+  }
+}
+
+// Would pick_next() choose p, just queued on c, over cur, which
+// c is running?  An EDF job comes before any other class, and
+// the class owning the current window before one that got the
+// CPU because that class was empty.
+static int
+outranks(struct cpu *c, struct proc *p, struct proc *cur)
+{
+  int q = p->sched_info.queue, cq = cur->sched_info.queue;
+
+  if(p->throttled || cq == EDF || q == cq)
+    return 0;
+  return q == EDF ||
+         q == window_class(c, (c->cpu_ticks % c->tune.period) + 1);
+}
+
+// Mark p RUNNABLE and queue it.  rq must be p's locked run queue.
+// If p should run before the process rq's CPU is running, have
+// that process yield at its next cond_resched().
+static void
+makerunnable(struct runqueue *rq, struct proc *p)
+{
+  struct cpu *c = &cpus[rq - runqueues];
+
+  p->state = RUNNABLE;
+  p->sched_info.runnable_tsc = rdtsc();
+  mlfq_refresh(p);
+  rq_enqueue(rq, p);
+  if(c->proc && c->proc != p && c->proc->state == RUNNING &&
+     outranks(c, p, c->proc))
+    c->need_resched = 1;
+}
+
+// The least loaded run queue p's affinity allows.
+static struct runqueue*
+affine_rq(struct proc *p)
+{
+  struct runqueue *r, *best = 0;
+
+  for(r = runqueues; r < &runqueues[ncpu]; r++)
+    if((p->affinity & (1 << (r - runqueues))) &&
+       (best == 0 || r->nrunnable < best->nrunnable))
+      best = r;
+  return best;
+}
+
+// p may no longer run on the CPU of rq, its locked run queue:
+// move it to the least loaded CPU it may run on.  Releases
+// rq->lock.  As in steal_work(), a queued p is unlinked under
+// the old lock and linked under the new one.
+static void
+push_away(struct runqueue *rq, struct proc *p)
+{
+  int queued = p->on_rq;
+
+  if(queued)
+    rq_dequeue(rq, p);
+  p->cpu = affine_rq(p) - runqueues;
+  release(&rq->lock);
+  if(queued){
+    rq = acquireprocrq(p);
+    rq_enqueue(rq, p);
+    kickcpu(rq, p);
+    release(&rq->lock);
+  }
+}
+
+// Give the new process np what it takes from its parent: its
+// scheduling settings, open files and current directory.
+static void
+inherit(struct proc *np, struct proc *parent)
+{
+  int i;
+
+  np->parent = parent;
+  np->sched_info.sjf.alpha = parent->sched_info.sjf.alpha;
+  np->sched_info.sjf.auto_burst = parent->sched_info.sjf.auto_burst;
+  np->sched_info.stride.tickets = parent->sched_info.stride.tickets;
+  set_stride(np);
+  np->affinity = parent->affinity;
+  np->group = parent->group;
+
+  for(i = 0; i < NOFILE; i++)
+    if(parent->ofile[i])
+      np->ofile[i] = filedup(parent->ofile[i]);
+  np->cwd = idup(parent->cwd);
+}
+
+// Start the new process np at the top level.  It starts on our
+// CPU if it may; idle CPUs steal it if we are busy.
+static void
+startchild(struct proc *np)
+{
+  struct runqueue *rq;
+
+  acquire(&tickslock);
+  np->creation_time = ticks;
+  np->sched_info.last_run = ticks;
+  np->sched_info.sjf.arrival_time = ticks;
+  release(&tickslock);
+
+  change_queue(np->pid, UNSET);
+
+  rq = acquirerq();
+  np->cpu = rq - runqueues;
+  makerunnable(rq, np);
+  if(np->affinity & (1 << np->cpu)){
+    kickcpu(rq, np);
+    release(&rq->lock);
+  } else
+    push_away(rq, np);
+}
+
 //PAGEBREAK: 32
 // Look in the process table for an UNUSED proc.
 // If found, change state to EMBRYO and initialize
@@ -76,7 +883,9 @@ static struct proc*
 allocproc(void)
 {
   struct proc *p;
+#ifndef SCHEDSIM
   char *sp;
+#endif
 
   acquire(&ptable.lock);
 
@@ -98,6 +907,8 @@ found:
     p->state = UNUSED;
     return 0;
   }
+  // The simulator never runs p on its kernel stack.
+#ifndef SCHEDSIM
   sp = p->kstack + KSTACKSIZE;
 
   // Leave room for trap frame.
@@ -113,6 +924,7 @@ found:
   p->context = (struct context*)sp;
   memset(p->context, 0, sizeof *p->context);
   p->context->eip = (uint)forkret;
+#endif
 
   // Initialize syscall_data to zero
   for (int i = 0; i < MAX_SYSCALLS; i++) {
@@ -122,11 +934,41 @@ found:
   p->syscall_counts = 0;
 
   p->sched_info.queue = UNSET;
+  p->sched_info.pinned = 0;
+  p->sched_info.promotions = 0;
+  p->sched_info.demotions = 0;
+  p->sched_info.nboost = 0;
+  p->sched_info.boosts = 0;
+  p->sched_info.boost_us = 0;
   p->sched_info.get_cpu_time = ticks;
+  memset(&p->sched_info.utime, 0, sizeof p->sched_info.utime);
+  memset(&p->sched_info.stime, 0, sizeof p->sched_info.stime);
   p->sched_info.sjf.arrival_time = ticks;
   p->sched_info.sjf.Confidence = 50;
   p->sched_info.sjf.BurstTime = 2;
+  p->sched_info.sjf.predicted = 2 * 100;
+  p->sched_info.sjf.alpha = 50;
+  p->sched_info.sjf.auto_burst = 1;
   p->consecutive_time= 0;
+  p->cpu = 0;
+  p->gang = -1;
+  p->group = 0;
+  p->throttled = 0;
+  p->exe = 0;
+  p->nseg = 0;
+  p->last_cpu = -1;
+  p->affinity = (1 << NCPU) - 1;
+  p->migrations = 0;
+  p->on_rq = 0;
+  p->sched_info.stride.tickets = DEFAULT_TICKETS;
+  p->sched_info.stride.lent = 0;
+  p->sched_info.stride.borrowed = 0;
+  p->sched_info.stride.lent_to = 0;
+  p->sched_info.stride.pass = 0;
+  set_stride(p);
+  memset(&p->sched_info.edf, 0, sizeof p->sched_info.edf);
+  p->rq_next = p->rq_prev = 0;
+  p->heap_index = -1;
 
   // Initialise shared pages
   for(int i = 0; i < NUM_SHARED_MEMORY; i++) {
@@ -140,11 +982,13 @@ found:
 }
 
 //PAGEBREAK: 32
+#ifndef SCHEDSIM
 // Set up first user process.
 void
 userinit(void)
 {
   struct proc *p;
+  struct runqueue *rq;
   extern char _binary_initcode_start[], _binary_initcode_size[];
 
   p = allocproc();
@@ -165,21 +1009,46 @@ userinit(void)
 
   safestrcpy(p->name, "initcode", sizeof(p->name));
   p->cwd = namei("/");
+  change_queue(p->pid, UNSET);
 
   // this assignment to p->state lets other cores
   // run this process. the acquire forces the above
   // writes to be visible, and the lock is also needed
   // because the assignment might not be atomic.
-  acquire(&ptable.lock);
-
-  p->state = RUNNABLE;
+  rq = acquirerq();
+  p->cpu = rq - runqueues;
+  makerunnable(rq, p);
+  release(&rq->lock);
+}
+#endif
 
-  release(&ptable.lock);
-  change_queue(p->pid, UNSET);
+// Forget the parts of p's program segments from sz up, whose
+// pages shrinking p has freed, so that memory grown back over
+// them is zero-filled rather than read from the file again.
+static void
+trimsegs(struct proc *p, uint sz)
+{
+  struct segment *s;
+  int i, n;
+
+  sz = PGROUNDUP(sz);
+  n = 0;
+  for(i = 0; i < p->nseg; i++){
+    s = &p->seg[i];
+    if(s->va >= sz)
+      continue;
+    if(s->filesz > sz - s->va)
+      s->filesz = sz - s->va;
+    if(s->memsz > sz - s->va)
+      s->memsz = sz - s->va;
+    p->seg[n++] = *s;
+  }
+  p->nseg = n;
 }
 
 // Grow current process's memory by n bytes.
-// Return 0 on success, -1 on failure.
+// Return 0 on success, -1 on failure.  New pages are not
+// allocated until they are first touched; see pagefault().
 int
 growproc(int n)
 {
@@ -188,11 +1057,13 @@ growproc(int n)
 
   sz = curproc->sz;
   if(n > 0){
-    if((sz = allocuvm(curproc->pgdir, sz, sz + n)) == 0)
+    if(sz + n < sz || sz + n > HEAPLIMIT)
       return -1;
+    sz += n;
   } else if(n < 0){
     if((sz = deallocuvm(curproc->pgdir, sz, sz + n)) == 0)
       return -1;
+    trimsegs(curproc, sz);
   }
   curproc->sz = sz;
   switchuvm(curproc);
@@ -222,17 +1093,17 @@ fork(void)
     return -1;
   }
   np->sz = curproc->sz;
-  np->parent = curproc;
+  if(curproc->exe)
+    np->exe = idup(curproc->exe);
+  np->nseg = curproc->nseg;
+  for(i = 0; i < curproc->nseg; i++)
+    np->seg[i] = curproc->seg[i];
   *np->tf = *curproc->tf;
+  inherit(np, curproc);
 
   // Clear %eax so that fork returns 0 in the child.
   np->tf->eax = 0;
 
-  for(i = 0; i < NOFILE; i++)
-    if(curproc->ofile[i])
-      np->ofile[i] = filedup(curproc->ofile[i]);
-  np->cwd = idup(curproc->cwd);
-
   safestrcpy(np->name, curproc->name, sizeof(curproc->name));
 
   pid = np->pid;
@@ -246,21 +1117,90 @@ fork(void)
       }
     }
   }
+  gang_update(np);
+  startchild(np);
 
-  acquire(&ptable.lock);
+  return pid;
+}
 
-  np->state = RUNNABLE;
+// Create a new process running the program at path with argv,
+// as fork() and exec() would, but loading the program straight
+// into the child instead of copying the caller first.  The child
+// inherits the caller's open files, then applies the nact
+// actions in act to them in order.  Returns the child's pid.
+int
+spawn(char *path, char **argv, struct spawnaction *act, int nact)
+{
+  int i, open[NOFILE];
+  struct image img;
+  char *s, *last;
+  struct file *f;
+  struct proc *np;
+  struct proc *curproc = myproc();
 
-  acquire(&tickslock);
-  np->creation_time = ticks;
-  np->sched_info.last_run = ticks;
-  np->sched_info.sjf.arrival_time = ticks;
-  release(&tickslock);
+  // Check the actions first, so that none can fail once applied.
+  for(i = 0; i < NOFILE; i++)
+    open[i] = curproc->ofile[i] != 0;
+  for(i = 0; i < nact; i++){
+    if(act[i].fd < 0 || act[i].fd >= NOFILE || !open[act[i].fd])
+      return -1;
+    if(act[i].op == SPAWN_CLOSE)
+      open[act[i].fd] = 0;
+    else if(act[i].op == SPAWN_DUP2 && act[i].newfd >= 0 && act[i].newfd < NOFILE)
+      open[act[i].newfd] = 1;
+    else
+      return -1;
+  }
 
-  release(&ptable.lock);
-  change_queue(np->pid, UNSET);
+  if((np = allocproc()) == 0)
+    return -1;
+  if(loaduser(path, argv, &img) < 0){
+    kfree(np->kstack);
+    np->kstack = 0;
+    np->state = UNUSED;
+    return -1;
+  }
+  setimage(np, &img);
+  memset(np->tf, 0, sizeof(*np->tf));
+  np->tf->cs = (SEG_UCODE << 3) | DPL_USER;
+  np->tf->ds = (SEG_UDATA << 3) | DPL_USER;
+  np->tf->es = np->tf->ds;
+  np->tf->ss = np->tf->ds;
+  np->tf->eflags = FL_IF;
+  np->tf->esp = img.sp;
+  np->tf->eip = img.entry;  // main
+  inherit(np, curproc);
+
+  for(i = 0; i < nact; i++){
+    if(act[i].op == SPAWN_CLOSE){
+      fileclose(np->ofile[act[i].fd]);
+      np->ofile[act[i].fd] = 0;
+    } else if(act[i].fd != act[i].newfd){
+      f = filedup(np->ofile[act[i].fd]);
+      if(np->ofile[act[i].newfd])
+        fileclose(np->ofile[act[i].newfd]);
+      np->ofile[act[i].newfd] = f;
+    }
+  }
 
-  return pid;
+  for(last=s=path; *s; s++)
+    if(*s == '/')
+      last = s+1;
+  safestrcpy(np->name, last, sizeof(np->name));
+
+  startchild(np);
+  return np->pid;
+}
+
+// p, running, exits: give back its EDF utilization and end its
+// burst.  For exit() and the simulator.  rq->lock must be held.
+static void
+exit_current(struct runqueue *rq, struct proc *p)
+{
+  if(p->sched_info.queue == EDF)
+    rq->edf_util -= p->sched_info.edf.util;
+  end_burst(p);
+  p->state = ZOMBIE;
 }
 
 // Exit the current process.  Does not return.
@@ -271,6 +1211,7 @@ exit(void)
 {
   struct proc *curproc = myproc();
   struct proc *p;
+  struct runqueue *rq;
   int fd;
 
   if(curproc == initproc)
@@ -292,25 +1233,36 @@ exit(void)
 
   begin_op();
   iput(curproc->cwd);
+  if(curproc->exe)
+    iput(curproc->exe);
   end_op();
   curproc->cwd = 0;
+  curproc->exe = 0;
 
   acquire(&ptable.lock);
 
   // Parent might be sleeping in wait().
   wakeup1(curproc->parent);
 
-  // Pass abandoned children to init.
+  // Pass abandoned children to init, and end the ticket
+  // loans we are part of.
+  end_loan(curproc);
   for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
     if(p->parent == curproc){
       p->parent = initproc;
       if(p->state == ZOMBIE)
         wakeup1(initproc);
     }
+    if(p->sched_info.stride.lent_to == curproc)
+      end_loan(p);
   }
 
   // Jump into the scheduler, never to return.
-  curproc->state = ZOMBIE;
+  // wait() locks our run queue before freeing the kernel stack,
+  // so the parent cannot reap us until we have switched away.
+  rq = acquirerq();
+  exit_current(rq, curproc);
+  release(&ptable.lock);
   sched();
   panic("zombie exit");
 }
@@ -321,6 +1273,7 @@ int
 wait(void)
 {
   struct proc *p;
+  struct runqueue *rq;
   int havekids, pid;
   struct proc *curproc = myproc();
   
@@ -333,7 +1286,10 @@ wait(void)
         continue;
       havekids = 1;
       if(p->state == ZOMBIE){
-        // Found one.
+        // Found one.  Wait for it to finish switching
+        // off its kernel stack before freeing it.
+        rq = acquireprocrq(p);
+        release(&rq->lock);
         pid = p->pid;
         kfree(p->kstack);
         p->kstack = 0;
@@ -360,96 +1316,651 @@ wait(void)
 }
 
 struct proc *
-round_robin(struct proc *last_scheduled)
+round_robin(struct runqueue *rq)
 {
-  struct proc *p = last_scheduled;
-  for (;;)
-  {
-    p++;
-    if (p >= &ptable.proc[NPROC])
-      p = ptable.proc;
+  return rq->list[ROUND_ROBIN].head;
+}
 
-    if (p->state == RUNNABLE && p->sched_info.queue == ROUND_ROBIN)
-      return p;
+// Per-CPU xorshift generator.  rq->lock must be held.
+static uint
+rq_random(struct runqueue *rq)
+{
+  uint x = rq->seed;
 
-    if (p == last_scheduled)
-      return 0;
-  }
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  rq->seed = x;
+  return x;
 }
 
-static unsigned int seed = 1;
+// Offer the SJF processes in burst-time order, each winning with
+// probability Confidence/100.  Rejected ones are popped off the
+// heap so the next shortest surfaces, then pushed back; if all
+// are rejected the longest job runs.
+struct proc *
+shortest_job_first(struct runqueue *rq)
+{
+  struct proc *skipped[NPROC];
+  struct proc *p = 0;
+  int n = 0;
 
-void srand(unsigned int s) {
-  seed = s;
+  while (rq->sjf.size > 0)
+  {
+    p = rq->sjf.proc[0];
+    if ((int)(rq_random(rq) % 100) < p->sched_info.sjf.Confidence)
+      break;
+    heap_remove(&rq->sjf, p);
+    skipped[n++] = p;
+    p = 0;
+  }
+
+  if (p == 0 && n > 0)
+    p = skipped[n - 1];
+  while (n > 0)
+    heap_push(&rq->sjf, skipped[--n]);
+  return p;
 }
 
-int rand(void) {
-  seed = (1103515245 * seed + 12345) & 0x7fffffff;
-  return seed;
+struct proc * first_come_first_serve(struct runqueue *rq)
+{
+  return rq->list[FCFS].head;
 }
 
-struct proc *
-shortest_job_first(void)
+// Move the EDF processes of rq whose next job has been released
+// from list[EDF] to the EDF heap.
+static void edf_release(struct runqueue *rq, uint now)
 {
-  struct proc *p;
-  struct proc *sjf_process[NPROC];
-  int count = 0;
+  struct proc *p, *next;
 
-  for (p = ptable.proc; p < &ptable.proc[NPROC]; p++)
+  for (p = rq->list[EDF].head; p; p = next)
   {
-    if (p->state == RUNNABLE && p->sched_info.queue == SJF)
+    next = p->rq_next;
+    if (edf_advance(p, now))
     {
-      sjf_process[count++] = p;
+      rq_dequeue(rq, p);
+      rq_enqueue(rq, p);
     }
   }
+}
 
-  if (count == 0)
-    return 0;
+// Requeue the throttled processes of rq whose group has a new
+// period's quota.
+static void group_release(struct runqueue *rq)
+{
+  struct proc *p, *next;
 
-  for (int i = 0; i < count - 1; i++)
+  for (p = rq->throttled.head; p; p = next)
   {
-    for (int j = i + 1; j < count; j++)
+    next = p->rq_next;
+    if (!group_over(p->group))
     {
-      if (sjf_process[i]->sched_info.sjf.BurstTime > sjf_process[j]->sched_info.sjf.BurstTime)
-      {
-        struct proc *temp = sjf_process[i];
-        sjf_process[i] = sjf_process[j];
-        sjf_process[j] = temp;
-      }
+      rq_dequeue(rq, p);
+      rq_enqueue(rq, p);
     }
   }
+}
 
-  for (int i = 0; i < count; i++)
+// Timer tick while p runs: has p's group used up its quota?
+int group_tick(struct proc *p)
+{
+  return p->sched_info.queue != EDF && group_over(p->group);
+}
+
+// The EDF process with the earliest deadline.  One that waited
+// past the end of its period is given its next job first.
+struct proc * earliest_deadline_first(struct runqueue *rq)
+{
+  while (rq->edf.size > 0)
   {
-    srand(i+1);
-    int rand_num = rand() % 100;
-    if (rand_num < sjf_process[i]->sched_info.sjf.Confidence)
+    if (!edf_advance(rq->edf.proc[0], ticks))
+      return rq->edf.proc[0];
+    heap_siftdown(&rq->edf, 0);
+  }
+  return 0;
+}
+
+// Timer tick while p runs: charge an EDF process for the tick
+// and release EDF jobs that are due.  Returns 1 if p should
+// yield because it used up its budget or a job with an earlier
+// deadline is ready.
+int edf_tick(struct proc *p)
+{
+  struct runqueue *rq;
+  struct edf_info *e = &p->sched_info.edf;
+  int preempt = 0;
+
+  if (p->sched_info.queue != EDF && runqueues[p->cpu].list[EDF].head == 0 &&
+      runqueues[p->cpu].edf.size == 0)
+    return 0;
+  rq = acquirerq();
+  edf_release(rq, ticks);
+  if (p->sched_info.queue == EDF)
+  {
+    edf_advance(p, ticks);
+    if (--e->budget <= 0)
+      preempt = 1;
+  }
+  if (rq->edf.size > 0 && (p->sched_info.queue != EDF || edf_less(rq->edf.proc[0], p)))
+    preempt = 1;
+  release(&rq->lock);
+  return preempt;
+}
+
+// The STRIDE process with the lowest pass.  Its pass becomes the
+// run queue's, which processes joining the class start from.
+struct proc * stride_scheduling(struct runqueue *rq)
+{
+  struct proc *p;
+
+  if (rq->stride.size == 0)
+    return 0;
+  p = rq->stride.proc[0];
+  rq->stride_pass = p->sched_info.stride.pass;
+  return p;
+}
+
+// Promote the queued processes of rq that have waited past the
+// aging threshold: FCFS moves to SJF and SJF to ROUND_ROBIN.
+// Called from scheduler() with rq->lock held rather than from the
+// timer interrupt; it walks only the wheel slots for the ticks
+// that passed since the last call.
+static void aging_process(struct runqueue *rq, uint os_ticks)
+{
+  struct agingwheel *w = &rq->aging;
+  struct proc *p, *next;
+
+  if (os_ticks - w->now > AGING_WHEEL)
+    w->now = os_ticks - AGING_WHEEL;
+
+  while (w->now != os_ticks)
+  {
+    w->now++;
+    for (p = w->slot[w->now % AGING_WHEEL]; p; p = next)
     {
-      return sjf_process[i];
+      next = p->age_next;
+      // Still a full turn of the wheel or more away.
+      if ((int)(p->age_expiry - os_ticks) > 0)
+        continue;
+
+      rq_dequeue(rq, p);
+      if (p->sched_info.queue == FCFS)
+        p->sched_info.queue = SJF;
+      else
+        p->sched_info.queue = ROUND_ROBIN;
+      p->sched_info.promotions++;
+      p->sched_info.arrival_queue_time = os_ticks;
+      p->sched_info.last_run = os_ticks;
+      rq_enqueue(rq, p);
     }
   }
+}
+
+// Once every MLFQ_RESET ticks, move the processes queued below
+// the top level on rq to ROUND_ROBIN.  The others move when they
+// are next queued (mlfq_refresh()).
+static void mlfq_reset(struct runqueue *rq, uint os_ticks)
+{
+  struct proc *moved[NPROC];
+  struct proc *p;
+  int i, n = 0;
+
+  if (rq->mlfq_epoch == os_ticks / MLFQ_RESET)
+    return;
+  rq->mlfq_epoch = os_ticks / MLFQ_RESET;
+
+  for (i = 0; i < rq->sjf.size; i++)
+    moved[n++] = rq->sjf.proc[i];
+  for (p = rq->list[FCFS].head; p; p = p->rq_next)
+    moved[n++] = p;
+  for (i = 0; i < n; i++)
+  {
+    p = moved[i];
+    if (!mlfq_managed(p))
+      continue;
+    rq_dequeue(rq, p);
+    mlfq_refresh(p);
+    rq_enqueue(rq, p);
+  }
+}
+
+static struct proc *
+pick_class(struct runqueue *rq, int q)
+{
+  switch (q) {
+  case ROUND_ROBIN:
+    return round_robin(rq);
+  case SJF:
+    return shortest_job_first(rq);
+  case FCFS:
+    return first_come_first_serve(rq);
+  case STRIDE:
+    return stride_scheduling(rq);
+  }
+  return 0;
+}
+
+// First tick (1-based) of class q's window in c's period.
+static int
+window_start(struct cpu *c, int q)
+{
+  int t = 1;
+
+  for (int i = ROUND_ROBIN; i < q; i++)
+    t += c->tune.share[i];
+  return t;
+}
+
+// The class whose window contains tick t of c's period.
+static int
+window_class(struct cpu *c, int t)
+{
+  int q, end = 0;
+
+  for (q = ROUND_ROBIN; q < NQUEUE - 1; q++) {
+    end += c->tune.share[q];
+    if (t <= end)
+      break;
+  }
+  return q;
+}
+
+// Does tick t close one of the class windows?  trap()
+// preempts the running process when it does.
+int
+window_end(struct cpu *c, int t)
+{
+  int q, end = 0;
 
-  return sjf_process[count - 1];
+  for (q = ROUND_ROBIN; q < NQUEUE; q++) {
+    end += c->tune.share[q];
+    if (c->tune.share[q] > 0 && t == end)
+      return 1;
+  }
+  return 0;
 }
 
-struct proc * first_come_first_serve(void)
+// Runnable processes on r that other CPUs may take.
+static int
+rq_stealable(struct runqueue *r)
+{
+  return r->nrunnable - r->count[EDF];
+}
+
+// May CPU cpu take p?  Not if p's affinity excludes it, nor,
+// for now, if p ran in the last MIGRATE_HOT ticks and so still
+// has warm cache state where it is; such a p is kept in *hot in
+// case nothing better turns up.  If gang is not -1, only its
+// members qualify, warm or not.
+static int
+steal_ok(struct proc *p, int cpu, int gang, struct proc **hot)
+{
+  if (!(p->affinity & (1 << cpu)))
+    return 0;
+  if (gang >= 0)
+    return p->gang == gang;
+  if (ticks - p->sched_info.last_run >= MIGRATE_HOT)
+    return 1;
+  if (*hot == 0)
+    *hot = p;
+  return 0;
+}
+
+// The process on r that CPU cpu should take, if any, searching
+// each class from the back of its queue.  If gang is not -1,
+// only its members are considered.  r->lock must be held.
+static struct proc*
+steal_candidate(struct runqueue *r, int cpu, int gang)
 {
-  struct proc *result = 0;
+  struct procheap *h;
+  struct proc *p, *hot = 0;
+  int q, i;
 
+  for (q = ROUND_ROBIN; q < NQUEUE; q++) {
+    if (r->count[q] == 0 || q == EDF)
+      continue;
+    if ((h = rq_heap(r, q)) != 0) {
+      for (i = h->size - 1; i >= 0; i--)
+        if (steal_ok(h->proc[i], cpu, gang, &hot))
+          return h->proc[i];
+    } else {
+      for (p = r->list[q].tail; p; p = p->rq_prev)
+        if (steal_ok(p, cpu, gang, &hot))
+          return p;
+    }
+  }
+  return hot;
+}
+
+// Unlink the process on r that CPU cpu should take, if any.
+static struct proc*
+steal_from(struct runqueue *r, int cpu)
+{
   struct proc *p;
+
+  acquire(&r->lock);
+  p = steal_candidate(r, cpu, -1);
+  if (p) {
+    rq_dequeue(r, p);
+    p->cpu = cpu;
+  }
+  release(&r->lock);
+  return p;
+}
+
+// Called by a CPU whose run queue is empty: move one runnable
+// process over from the busiest other CPU, or from any other
+// if affinity keeps all of the busiest one's here.  The victim
+// is taken from the tail of its ready list, where it is least
+// likely to still have warm cache state on the CPU it is
+// leaving, and must be allowed to run here.
+static void
+steal_work(struct runqueue *rq)
+{
+  struct runqueue *r, *busiest = 0;
+  struct proc *p = 0;
+
+  for (r = runqueues; r < &runqueues[ncpu]; r++)
+    if (r != rq && rq_stealable(r) > 0 &&
+        (busiest == 0 || rq_stealable(r) > rq_stealable(busiest)))
+      busiest = r;
+  if (busiest == 0)
+    return;
+
+  p = steal_from(busiest, rq - runqueues);
+  for (r = runqueues; r < &runqueues[ncpu] && p == 0; r++)
+    if (r != rq && r != busiest && rq_stealable(r) > 0)
+      p = steal_from(r, rq - runqueues);
+
+  if (p) {
+    acquire(&rq->lock);
+    rq_enqueue(rq, p);
+    release(&rq->lock);
+  }
+}
+
+// Nothing is runnable here, and nothing on any other CPU that
+// this one may take: halt until an interrupt arrives instead of
+// spinning on the run queue locks.  c->idle is set before
+// looking for work, so a CPU that queues work after the check
+// sees it and sends an IPI, and sti_hlt() cannot miss that
+// interrupt.
+static void
+idle(struct cpu *c)
+{
+  struct runqueue *r;
+  int work = 0;
+
+  cli();
+  c->idle = 1;
+  __sync_synchronize();
+  for(r = runqueues; r < &runqueues[ncpu] && !work; r++){
+    if(r == &runqueues[c - cpus])
+      work = r->nrunnable > 0;
+    else if(rq_stealable(r) > 0){
+      acquire(&r->lock);
+      work = steal_candidate(r, c - cpus, -1) != 0;
+      release(&r->lock);
+    }
+  }
+  if(!work)
+    sti_hlt();
+  c->idle = 0;
+  sti();
+}
+
+// Gang g was turned off or lost its last member: forget the
+// members CPUs were called to run for it, so that pick_next()
+// does not take one for a gang that reuses the slot.
+static void gang_forget(int g)
+{
+  struct runqueue *r;
+
+  for (r = runqueues; r < &runqueues[ncpu]; r++) {
+    acquire(&r->lock);
+    if (r->gang_next && r->gang_next_gang == g)
+      r->gang_next = 0;
+    release(&r->lock);
+  }
+}
+
+// Recompute which gang p belongs to after it attached or
+// detached a shared memory region.
+void gang_update(struct proc *p)
+{
+  int i, g = -1, emptied = -1;
+
+  acquire(&gangs.lock);
+  for (i = 0; i < NUM_SHARED_MEMORY && g < 0; i++)
+    if (p->pages[i].key != -1 && p->pages[i].mem_id >= 0 &&
+        p->pages[i].mem_id < NUM_SHARED_MEMORY &&
+        gangs.gang[p->pages[i].mem_id].enabled)
+      g = p->pages[i].mem_id;
+  if (g != p->gang) {
+    if (p->gang >= 0 && --gangs.gang[p->gang].nmembers == 0)
+      emptied = p->gang;
+    if (g >= 0)
+      gangs.gang[g].nmembers++;
+    p->gang = g;
+  }
+  release(&gangs.lock);
+  if (emptied >= 0)
+    gang_forget(emptied);
+}
+
+// Turn gang scheduling of shared memory region mem_id on or off.
+int set_gang(int mem_id, int enabled)
+{
+  struct proc *p;
+
+  if (mem_id < 0 || mem_id >= NUM_SHARED_MEMORY)
+    return -1;
+  acquire(&gangs.lock);
+  gangs.gang[mem_id].enabled = enabled;
+  release(&gangs.lock);
+
+  acquire(&ptable.lock);
   for (p = ptable.proc; p < &ptable.proc[NPROC]; p++)
-  {
-    if (p->state != RUNNABLE || p->sched_info.queue != FCFS)
+    if (p->state != UNUSED && p->state != ZOMBIE)
+      gang_update(p);
+  release(&ptable.lock);
+  if (!enabled)
+    gang_forget(mem_id);
+  return 0;
+}
+
+static int
+gang_slot_open(struct gang *g)
+{
+  return g->slot_end != 0 && (int)(ticks - g->slot_end) < 0;
+}
+
+// Member p is being dispatched on c.  Join the gang's open slot,
+// or open one and call other CPUs to run the other members.
+static void gang_dispatch(struct cpu *c, struct proc *p)
+{
+  struct gang *g;
+  struct proc *q;
+  uint called;
+  int n;
+
+  acquire(&gangs.lock);
+  g = &gangs.gang[p->gang];
+  if (gang_slot_open(g)) {
+    g->joins++;
+    release(&gangs.lock);
+    return;
+  }
+  g->slot_end = ticks + c->tune.rr_quantum;
+  g->slots++;
+  n = g->nmembers - 1;
+  release(&gangs.lock);
+
+  // Call the CPUs where other members wait.  Their run queues
+  // cannot be locked under ours, so this reads the process table
+  // unlocked; gang_call() checks again under the lock.
+  called = 1 << (c - cpus);
+  for (q = ptable.proc; q < &ptable.proc[NPROC] && n > 0; q++) {
+    if (q == p || q->gang != p->gang || q->state != RUNNABLE || !q->on_rq ||
+        q->cpu < 0 || q->cpu >= ncpu || (called & (1 << q->cpu)))
       continue;
-    if (result != 0)
-    {
-      if (result->sched_info.arrival_queue_time > p->sched_info.arrival_queue_time)
-        result = p;
+    called |= 1 << q->cpu;
+    cpus[q->cpu].gang_call = p->gang + 1;
+    lapicipi(cpus[q->cpu].apicid, T_IRQ0 + IRQ_RESCHED);
+    n--;
+  }
+}
+
+// Timer tick while p runs: is p a gang member whose slot is over?
+int gang_expired(struct proc *p)
+{
+  int g = p->gang, expired = 0;
+
+  if (g < 0)
+    return 0;
+  acquire(&gangs.lock);
+  if (!gang_slot_open(&gangs.gang[g])) {
+    gangs.gang[g].preempts++;
+    expired = 1;
+  }
+  release(&gangs.lock);
+  return expired;
+}
+
+// This CPU was called by IPI to run a member of a gang whose
+// slot just opened.  Find a queued member here, or pull one from
+// another CPU, and have pick_next() choose it.  Returns 1 if the
+// running process should make way for it.
+int gang_call(void)
+{
+  struct cpu *c = mycpu();
+  struct runqueue *rq = &runqueues[c - cpus], *r;
+  struct proc *p;
+  int g = c->gang_call - 1;
+  int cpu = c - cpus;
+
+  c->gang_call = 0;
+  if (g < 0 || (c->proc && c->proc->gang == g))
+    return 0;
+  acquire(&gangs.lock);
+  if (!gang_slot_open(&gangs.gang[g])) {
+    release(&gangs.lock);
+    return 0;
+  }
+  release(&gangs.lock);
+
+  acquire(&rq->lock);
+  p = steal_candidate(rq, cpu, g);
+  if (p) {
+    rq->gang_next = p;
+    rq->gang_next_gang = g;
+  }
+  release(&rq->lock);
+
+  // As in steal_work(), p is unlinked under one lock and linked
+  // under the other.
+  for (r = runqueues; p == 0 && r < &runqueues[ncpu]; r++) {
+    if (r == rq)
+      continue;
+    acquire(&r->lock);
+    p = steal_candidate(r, cpu, g);
+    if (p && p->sched_info.queue != EDF) {
+      rq_dequeue(r, p);
+      p->cpu = cpu;
+    } else
+      p = 0;
+    release(&r->lock);
+    if (p) {
+      r = acquireprocrq(p);
+      rq_enqueue(r, p);
+      r->gang_next = p;
+      r->gang_next_gang = g;
+      release(&r->lock);
+      acquire(&gangs.lock);
+      gangs.gang[g].pulls++;
+      release(&gangs.lock);
+      break;
     }
-    else
-      result = p;
   }
-  return result;
+  return p != 0;
+}
+
+// Choose the next process to run from rq, or return 0 if there
+// is none.  The choice stays queued.  rq->lock must be held.
+static struct proc *
+pick_next(struct runqueue *rq, struct cpu *c)
+{
+  struct proc *p;
+  int q;
+
+  aging_process(rq, ticks);
+  mlfq_reset(rq, ticks);
+  edf_release(rq, ticks);
+  group_release(rq);
+
+  // EDF jobs run first.  Otherwise start with the class that
+  // owns this tick of the period and fall through to the later
+  // windows while a class is empty.
+  int time_period = (c->cpu_ticks % c->tune.period) + 1;
+  p = earliest_deadline_first(rq);
+  if (p == 0 && rq->gang_next) {
+    // A gang member this CPU was called to run.
+    if (queued_ready(rq->gang_next) && rq->gang_next->cpu == rq - runqueues &&
+        rq->gang_next->gang == rq->gang_next_gang)
+      p = rq->gang_next;
+    rq->gang_next = 0;
+  }
+  for (q = window_class(c, time_period); q < NQUEUE && p == 0; q++) {
+    if (c->tune.share[q] == 0)
+      continue;
+    if (window_start(c, q) > time_period)
+      time_period = window_start(c, q);
+    p = pick_class(rq, q);
+  }
+  if (p)
+    c->cpu_ticks = time_period - 1;
+  else
+    c->cpu_ticks = 0;
+  return p;
+}
+
+// Take p, chosen by pick_next(), off rq and make it c's
+// running process.  rq->lock must be held.
+static void
+dispatch(struct runqueue *rq, struct cpu *c, struct proc *p)
+{
+  rq_dequeue(rq, p);
+  p->cpu = rq - runqueues;
+  if (p->last_cpu >= 0 && p->last_cpu != p->cpu)
+    p->migrations++;
+  p->last_cpu = p->cpu;
+  p->sched_info.dispatch_queue = p->sched_info.queue;
+
+  if (c->proc != p) {
+    c->proc = p;
+    switchuvm(p);
+  }
+
+  p->state = RUNNING;
+  p->sched_info.get_cpu_time = ticks;
+  p->sched_info.running_tsc = rdtsc();
+  p->sched_info.acct_tsc = p->sched_info.running_tsc;
+  hist_add(rq->hist[p->sched_info.dispatch_queue].wait,
+           p->sched_info.running_tsc - p->sched_info.runnable_tsc);
+  p->consecutive_time= 0;
+  c->need_resched = 0;
+  if (p->gang >= 0)
+    gang_dispatch(c, p);
+}
+
+// p has stopped running on rq's CPU.
+static void
+undispatch(struct runqueue *rq, struct proc *p)
+{
+  account(p, 0);
+  p->sched_info.last_run = ticks;
+  hist_add(rq->hist[p->sched_info.dispatch_queue].slice,
+           rdtsc() - p->sched_info.running_tsc);
 }
 
 //PAGEBREAK: 42
@@ -460,111 +1971,323 @@ struct proc * first_come_first_serve(void)
 //  - swtch to start running that process
 //  - eventually that process transfers control
 //      via swtch back to the scheduler.
+// Processes usually hand the CPU straight to each other in
+// sched(); they come back here only when nothing else on this
+// CPU can run, or to move off it.
 void
 scheduler(void)
 {
   struct proc *p;
-  struct proc *last_scheduled_RR = &ptable.proc[NPROC - 1];
   struct cpu *c = mycpu();
+  struct runqueue *rq = &runqueues[cpuid()];
   c->proc = 0;
+  rq->seed = (uint)rdtsc() ^ (cpuid() + 1) * 0x9E3779B9;
+  if (rq->seed == 0)
+    rq->seed = 1;
 
   for (;;)
   {
     // Enable interrupts on this processor.
     sti();
 
-    // Loop over process table looking for process to run.
-    acquire(&ptable.lock);
-    p = round_robin(last_scheduled_RR);
-
-    int time_period = (c->cpu_ticks % 60) + 1;
-    if (time_period <= 30) {
-      p = round_robin(last_scheduled_RR);
-      if(p) {
-        last_scheduled_RR = p;
-      }
-      else {
-        time_period = 31; 
-      }
-    }
-
-    if (time_period >= 31 && time_period <= 50) {
-      p = shortest_job_first();
-      if (!p) {
-        time_period = 51;
-      }
-    }
-
-    if (time_period >= 51) {
-      p = first_come_first_serve();
-      if (!p) {
-        c->cpu_ticks = 0;
-        release(&ptable.lock);
-        continue;
-      }
+    if (rq->nrunnable == 0)
+      steal_work(rq);
+
+    // Look in this CPU's run queue for a process to run.
+    acquire(&rq->lock);
+    p = pick_next(rq, c);
+    if (!p) {
+      int empty = rq->nrunnable == 0;
+      release(&rq->lock);
+      if (empty)
+        idle(c);
+      continue;
     }
-    c->cpu_ticks = time_period - 1;
 
     // Switch to chosen process.  It is the process's job
-    // to release ptable.lock and then reacquire it
+    // to release rq->lock and then reacquire it
     // before jumping back to us.
-
-    if (c->proc)
-      c->proc->sched_info.last_run = ticks;
-    c->proc = p;
-    switchuvm(p);
-
-    p->state = RUNNING;
-    p->sched_info.get_cpu_time = ticks;
-
-    // p->sched_info.last_run = ticks;
-    p->consecutive_time= 0;
-
+    dispatch(rq, c, p);
     swtch(&(c->scheduler), p->context);
-
     switchkvm();
 
-    // Process is done running for now.
+    // The process that switched back, which after direct
+    // switches need not be p, is done running for now.
     // It should have changed its p->state before coming back.
+    // If its affinity changed while it ran, send it elsewhere.
+    p = c->proc;
+    undispatch(rq, p);
     c->proc = 0;
-    release(&ptable.lock);
+    if (!(p->affinity & (1 << p->cpu)) &&
+        (p->state == RUNNABLE || p->state == SLEEPING))
+      push_away(rq, p);
+    else
+      release(&rq->lock);
   }
 }
 
-// Enter scheduler.  Must hold only ptable.lock
-// and have changed proc->state. Saves and restores
+// Switch from the current process p to next, which must be
+// queued on this CPU's locked run queue rq, or back to the
+// scheduler if next is 0.  Going straight to next saves the
+// second swtch() through the scheduler; next releases rq->lock
+// just as it would after coming from scheduler().
+static void
+switchto(struct runqueue *rq, struct proc *p, struct proc *next)
+{
+  struct cpu *c = mycpu();
+  int intena = c->intena;
+
+  if (next) {
+    undispatch(rq, p);
+    dispatch(rq, c, next);
+    if (next != p)
+      swtch(&p->context, next->context);
+  } else
+    swtch(&p->context, c->scheduler);
+  mycpu()->intena = intena;
+}
+
+// Enter scheduler.  Must hold only this CPU's run queue
+// lock and have changed proc->state. Saves and restores
 // intena because intena is a property of this
 // kernel thread, not this CPU. It should
 // be proc->intena and proc->ncli, but that would
 // break in the few places where a lock is held but
 // there's no process.
+// The next process is picked here and switched to directly,
+// unless p has to leave this CPU, which scheduler() handles.
 void
 sched(void)
 {
-  int intena;
   struct proc *p = myproc();
+  struct runqueue *rq = &runqueues[cpuid()];
+  struct proc *next = 0;
 
-  if(!holding(&ptable.lock))
-    panic("sched ptable.lock");
+  if(!holding(&rq->lock))
+    panic("sched rq.lock");
   if(mycpu()->ncli != 1)
     panic("sched locks");
   if(p->state == RUNNING)
     panic("sched running");
   if(readeflags()&FL_IF)
     panic("sched interruptible");
-  intena = mycpu()->intena;
-  swtch(&p->context, mycpu()->scheduler);
-  mycpu()->intena = intena;
+  if((p->affinity & (1 << cpuid())) || p->state == ZOMBIE)
+    next = pick_next(rq, mycpu());
+  switchto(rq, p, next);
+}
+
+// A timer tick on CPU c while p runs there: account for it and
+// return 1 if p is to be preempted, at the end of its slice, of
+// the class window, of its EDF budget, of its gang's slot or of
+// its group's quota.  For trap() and the simulator.
+int
+timer_tick(struct cpu *c, struct proc *p)
+{
+  int t, sliced, edf;
+
+  p->consecutive_time++;
+  p->sched_info.last_run = ticks;
+  t = (c->cpu_ticks % c->tune.period) + 1;
+  c->cpu_ticks++;
+  sliced = p->sched_info.queue == ROUND_ROBIN || p->sched_info.queue == STRIDE;
+  edf = edf_tick(p);
+  return (sliced && p->consecutive_time >= c->tune.rr_quantum) ||
+         window_end(c, t) || edf || gang_expired(p) || group_tick(p);
+}
+
+// p, running on c, stops to sleep: end its burst and job, and
+// move it up in MLFQ if it blocked before its slice was over,
+// which marks it as interactive.  For sleep() and the simulator.
+// p's run queue lock must be held.
+static void
+block_current(struct cpu *c, struct proc *p)
+{
+  end_burst(p);
+  end_job(p);
+  if(mlfq_managed(p) && p->sched_info.queue > ROUND_ROBIN &&
+     p->consecutive_time < mlfq_slice(c, p->sched_info.queue))
+    mlfq_move(p, -1);
+  p->state = SLEEPING;
+}
+
+// p, running on c, gives up the CPU but stays runnable: end its
+// burst and queue it again.  If it was preempted, move it down
+// in MLFQ if it ran for its whole slice; a voluntary reschedule
+// leaves its level alone.  For yield(), cond_resched() and the
+// simulator.  rq->lock must be held.
+static void
+requeue_current(struct runqueue *rq, struct cpu *c, struct proc *p, int preempted)
+{
+  end_burst(p);
+  if(preempted && mlfq_managed(p) && p->sched_info.queue < FCFS &&
+     p->consecutive_time >= mlfq_slice(c, p->sched_info.queue))
+    mlfq_move(p, 1);
+  makerunnable(rq, p);
 }
 
 // Give up the CPU for one scheduling round.
+static void
+giveup(int preempted)
+{
+  struct runqueue *rq = acquirerq();  //DOC: yieldlock
+
+  requeue_current(rq, mycpu(), myproc(), preempted);
+  sched();
+  releaserq();
+}
+
+// Preempt the current process, from trap().
 void
 yield(void)
 {
-  acquire(&ptable.lock);  //DOC: yieldlock
-  myproc()->state = RUNNABLE;
-  sched();
+  giveup(1);
+}
+
+// A preemption checkpoint for long loops in the kernel.  The
+// timer tick only preempts at the end of a slice or window, so
+// without this a process that woke up in a class that should
+// run now waits for the loop to finish.  Yields if such a
+// process is queued on this CPU and no spinlock is held.
+void
+cond_resched(void)
+{
+  struct proc *p = myproc();
+  struct cpu *c;
+  int resched;
+
+  pushcli();
+  c = mycpu();
+  resched = c->need_resched && c->ncli == 1 && c->intena;
+  if(resched)
+    c->kpreempts++;
+  popcli();
+  if(resched && p && p->state == RUNNING)
+    giveup(0);
+}
+
+// Give the CPU straight to process pid, which must be RUNNABLE
+// and allowed on this CPU, moving it to this CPU's run queue if
+// it is queued elsewhere.  The caller stays runnable.  For
+// producer/consumer pairs: hand over to the consumer right after
+// waking it.  Returns -1 if pid cannot run here now.
+int
+yield_to(int pid)
+{
+  struct proc *curproc = myproc();
+  struct proc *p;
+  struct runqueue *rq;
+  int cpu;
+
+  acquire(&ptable.lock);
+  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++)
+    if(p->pid == pid && p != curproc && p->state != UNUSED)
+      break;
+  if(p == &ptable.proc[NPROC]){
+    release(&ptable.lock);
+    return -1;
+  }
+
+  pushcli();
+  cpu = cpuid();
+  popcli();
+  rq = acquireprocrq(p);
   release(&ptable.lock);
+  if(p->state != RUNNABLE || !queued_ready(p) || !(p->affinity & (1 << cpu)) ||
+     (p->cpu != cpu && p->sched_info.queue == EDF)){
+    release(&rq->lock);
+    return -1;
+  }
+  if(p->cpu != cpu){
+    // Pull p over, as steal_work() does.
+    rq_dequeue(rq, p);
+    p->cpu = cpu;
+    release(&rq->lock);
+    rq = acquireprocrq(p);
+    rq_enqueue(rq, p);
+    release(&rq->lock);
+  } else
+    release(&rq->lock);
+
+  // We may have moved since reading cpu; p must be queued here.
+  rq = acquirerq();
+  if(p->state != RUNNABLE || !queued_ready(p) || p->cpu != rq - runqueues){
+    release(&rq->lock);
+    return -1;
+  }
+  end_burst(curproc);
+  makerunnable(rq, curproc);
+  switchto(rq, curproc, p);
+  releaserq();
+  return 0;
+}
+
+// Move p to class q, requeueing it if it is queued.  p's run
+// queue lock must be held.
+static void
+requeue_class(struct runqueue *rq, struct proc *p, int q)
+{
+  int queued = p->on_rq;
+
+  if(queued)
+    rq_dequeue(rq, p);
+  p->sched_info.queue = q;
+  p->sched_info.arrival_queue_time = ticks;
+  if(queued)
+    rq_enqueue(rq, p);
+}
+
+// Priority inheritance for sleeplocks.  waiter is about to sleep
+// on a sleeplock held by holder: if holder's class comes after
+// waiter's, run holder in waiter's class until it releases the
+// lock, so that a lock held by an FCFS process does not make a
+// ROUND_ROBIN one wait for the FCFS window.  Classes rank in
+// enum order; an EDF waiter lends ROUND_ROBIN, since the holder
+// was never admitted, and an EDF holder is left alone.  counted
+// says whether the lock already boosted holder.  Returns whether
+// it has now.  The lock's spinlock must be held.
+int
+inherit_priority(struct proc *holder, struct proc *waiter, int counted)
+{
+  struct runqueue *rq;
+  int q = waiter->sched_info.queue;
+
+  if(holder == 0 || holder == waiter)
+    return counted;
+  if(q == EDF)
+    q = ROUND_ROBIN;
+  rq = acquireprocrq(holder);
+  if(holder->sched_info.queue == EDF || holder->sched_info.queue <= q){
+    release(&rq->lock);
+    return counted;
+  }
+  if(holder->sched_info.nboost == 0){
+    holder->sched_info.base_queue = holder->sched_info.queue;
+    holder->sched_info.boost_tsc = rdtsc();
+  }
+  if(!counted)
+    holder->sched_info.nboost++;
+  holder->sched_info.boosts++;
+  requeue_class(rq, holder, q);
+  release(&rq->lock);
+  return 1;
+}
+
+// p released a sleeplock a waiter boosted it for.  Once it holds
+// none, return it to its own class.
+void
+end_inheritance(struct proc *p)
+{
+  struct runqueue *rq = acquireprocrq(p);
+  uint64 d;
+
+  if(--p->sched_info.nboost == 0){
+    d = rdtsc() - p->sched_info.boost_tsc;
+    if(d > 0xFFFFFFFF)
+      d = 0xFFFFFFFF;
+    p->sched_info.boost_us += (uint)d / tsc_per_us;
+    requeue_class(rq, p, p->sched_info.base_queue);
+  }
+  release(&rq->lock);
 }
 
 // A fork child's very first scheduling by scheduler()
@@ -573,8 +2296,8 @@ void
 forkret(void)
 {
   static int first = 1;
-  // Still holding ptable.lock from scheduler.
-  release(&ptable.lock);
+  // Still holding the run queue lock from scheduler.
+  releaserq();
 
   if (first) {
     // Some initialization functions must be run in the context
@@ -588,12 +2311,21 @@ forkret(void)
   // Return to "caller", actually trapret (see allocproc).
 }
 
+// The wait queue for chan.  Channels are addresses, often of
+// neighbouring objects, so spread them with a multiplicative hash.
+static struct waitqueue*
+waitqueue(void *chan)
+{
+  return &waitqueues[((uint)(uintptr)chan * 2654435761U) >> 26 & (NWAITQ - 1)];
+}
+
 // Atomically release lock and sleep on chan.
 // Reacquires lock when awakened.
 void
 sleep(void *chan, struct spinlock *lk)
 {
   struct proc *p = myproc();
+  struct waitqueue *wq;
   
   if(p == 0)
     panic("sleep");
@@ -601,52 +2333,77 @@ sleep(void *chan, struct spinlock *lk)
   if(lk == 0)
     panic("sleep without lk");
 
-  // Must acquire ptable.lock in order to
+  // Wakers hold lk, so they cannot look for us before we are
+  // SLEEPING even though we are already on the wait queue.
+  wq = waitqueue(chan);
+  acquire(&wq->lock);
+  p->wq_prev = 0;
+  p->wq_next = wq->head;
+  if(wq->head)
+    wq->head->wq_prev = p;
+  wq->head = p;
+  release(&wq->lock);
+
+  // Must acquire our run queue lock in order to
   // change p->state and then call sched.
-  // Once we hold ptable.lock, we can be
-  // guaranteed that we won't miss any wakeup
-  // (wakeup runs with ptable.lock locked),
-  // so it's okay to release lk.
-  if(lk != &ptable.lock){  //DOC: sleeplock0
-    acquire(&ptable.lock);  //DOC: sleeplock1
-    release(lk);
-  }
-  // Go to sleep.
+  // The state is changed before lk is released:
+  // a waker must hold lk, so it is guaranteed to
+  // see SLEEPING, and it then waits on the run queue
+  // lock until we have switched away.
+  acquirerq();  //DOC: sleeplock1
   p->chan = chan;
-  p->state = SLEEPING;
+  block_current(mycpu(), p);
+  release(lk);  //DOC: sleeplock0
 
   sched();
 
   // Tidy up.
   p->chan = 0;
+  releaserq();  //DOC: sleeplock2
+
+  acquire(&wq->lock);
+  if(p->wq_prev)
+    p->wq_prev->wq_next = p->wq_next;
+  else
+    wq->head = p->wq_next;
+  if(p->wq_next)
+    p->wq_next->wq_prev = p->wq_prev;
+  release(&wq->lock);
 
   // Reacquire original lock.
-  if(lk != &ptable.lock){  //DOC: sleeplock2
-    release(&ptable.lock);
-    acquire(lk);
-  }
+  acquire(lk);
 }
 
 //PAGEBREAK!
 // Wake up all processes sleeping on chan.
-// The ptable lock must be held.
+// Only chan's wait queue is searched, and each sleeper is
+// rechecked under its run queue lock; ptable.lock is not needed.
 static void
 wakeup1(void *chan)
 {
   struct proc *p;
+  struct runqueue *rq;
+  struct waitqueue *wq = waitqueue(chan);
 
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++)
-    if(p->state == SLEEPING && p->chan == chan)
-      p->state = RUNNABLE;
+  acquire(&wq->lock);
+  for(p = wq->head; p; p = p->wq_next){
+    if(p->state != SLEEPING || p->chan != chan)
+      continue;
+    rq = acquireprocrq(p);
+    if(p->state == SLEEPING && p->chan == chan){
+      makerunnable(rq, p);
+      kickcpu(rq, p);
+    }
+    release(&rq->lock);
+  }
+  release(&wq->lock);
 }
 
 // Wake up all processes sleeping on chan.
 void
 wakeup(void *chan)
 {
-  acquire(&ptable.lock);
   wakeup1(chan);
-  release(&ptable.lock);
 }
 
 // Kill the process with the given pid.
@@ -656,14 +2413,21 @@ int
 kill(int pid)
 {
   struct proc *p;
+  struct runqueue *rq;
 
   acquire(&ptable.lock);
   for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
     if(p->pid == pid){
       p->killed = 1;
       // Wake process from sleep if necessary.
-      if(p->state == SLEEPING)
-        p->state = RUNNABLE;
+      if(p->state == SLEEPING){
+        rq = acquireprocrq(p);
+        if(p->state == SLEEPING){
+          makerunnable(rq, p);
+          kickcpu(rq, p);
+        }
+        release(&rq->lock);
+      }
       release(&ptable.lock);
       return 0;
     }
@@ -673,6 +2437,7 @@ kill(int pid)
 }
 
 //PAGEBREAK: 36
+#ifndef SCHEDSIM
 // Print a process listing to console.  For debugging.
 // Runs when user types ^P on console.
 // No lock to avoid wedging a stuck machine further.
@@ -708,6 +2473,7 @@ procdump(void)
     cprintf("\n");
   }
 }
+#endif
 
 int compare_string(char *first, char *second) {
     if (first == NULL || second == NULL) {
@@ -728,65 +2494,90 @@ int compare_string(char *first, char *second) {
 int change_queue(int pid, int new_queue)
 {
   struct proc *p;
+  struct runqueue *rq;
   int old_queue = -1;
+  int queued;
 
+  // New programs start at the top MLFQ level.
   if (new_queue == UNSET)
   {
-    if (pid == 1 || pid == 2)
-      new_queue = ROUND_ROBIN;
-    else if (pid > 2)
-      new_queue = FCFS;
-    else
+    if (pid < 1)
       return -1;
+    new_queue = ROUND_ROBIN;
   }
   acquire(&ptable.lock);
   for (p = ptable.proc; p < &ptable.proc[NPROC]; p++)
   {
     if (p->pid == pid)
     {
+      // Move a queued process over to its new class's ready list.
+      rq = acquireprocrq(p);
+      queued = p->on_rq;
+      if (queued)
+        rq_dequeue(rq, p);
+
       old_queue = p->sched_info.queue;
-      if (compare_string(p->name, "sh") || compare_string(p->name, "init"))
+      // A boosted process takes its new class once unboosted.
+      if (p->sched_info.nboost > 0 && new_queue != EDF)
+      {
+        p->sched_info.base_queue = new_queue;
+        if (queued)
+          rq_enqueue(rq, p);
+        release(&rq->lock);
+        continue;
+      }
+      p->sched_info.pinned = compare_string(p->name, "sh") || compare_string(p->name, "init");
+      if (p->sched_info.pinned)
         p->sched_info.queue = ROUND_ROBIN;
       else
         p->sched_info.queue = new_queue;
+      p->sched_info.mlfq_epoch = ticks / MLFQ_RESET;
+      if (old_queue == EDF && p->sched_info.queue != EDF)
+        rq->edf_util -= p->sched_info.edf.util;
 
       p->sched_info.arrival_queue_time = ticks;
+      if (queued)
+        rq_enqueue(rq, p);
+      release(&rq->lock);
     }
   }
   release(&ptable.lock);
   return old_queue;
 }
 
-void aging_process(int os_ticks)
+int set_sjf_params(int pid, int burstTime, int confidence)
 {
   struct proc *p;
+  struct runqueue *rq;
+
   acquire(&ptable.lock);
   for (p = ptable.proc; p < &ptable.proc[NPROC]; p++)
   {
-    if (p->state == RUNNABLE && p->sched_info.queue != ROUND_ROBIN)
+    if (p->pid == pid)
     {
-      if (os_ticks - p->sched_info.last_run > AGING_THRESHOLD)
-      {
-        if (p->sched_info.queue == FCFS) {
-            release(&ptable.lock);
-            change_queue(p->pid, SJF);
-            p->sched_info.last_run = ticks;
-            acquire(&ptable.lock);
-        }
-        else {
-          release(&ptable.lock);
-          change_queue(p->pid, ROUND_ROBIN);
-            p->sched_info.last_run = ticks;
-          acquire(&ptable.lock);
-
-        }
+      // Re-key p in place if it is waiting in an SJF heap.
+      rq = acquireprocrq(p);
+      p->sched_info.sjf.BurstTime = burstTime;
+      p->sched_info.sjf.predicted = burstTime * 100;
+      p->sched_info.sjf.Confidence = confidence;
+      if (p->on_rq && p->sched_info.queue == SJF) {
+        heap_siftdown(&rq->sjf, p->heap_index);
+        heap_siftup(&rq->sjf, p->heap_index);
       }
+      release(&rq->lock);
+      release(&ptable.lock);
+      return 0;
     }
   }
   release(&ptable.lock);
+  return -1;
 }
 
-int set_sjf_params(int pid, int burstTime, int confidence)
+
+// Configure burst prediction for pid: alpha is the weight, in
+// percent, of the most recent burst; enabled chooses whether
+// BurstTime follows the prediction or keeps its manual value.
+int set_burst_prediction(int pid, int enabled, int alpha)
 {
   struct proc *p;
 
@@ -795,8 +2586,8 @@ int set_sjf_params(int pid, int burstTime, int confidence)
   {
     if (p->pid == pid)
     {
-      p->sched_info.sjf.BurstTime = burstTime;
-      p->sched_info.sjf.Confidence = confidence;
+      p->sched_info.sjf.auto_burst = enabled;
+      p->sched_info.sjf.alpha = alpha;
       release(&ptable.lock);
       return 0;
     }
@@ -805,6 +2596,286 @@ int set_sjf_params(int pid, int burstTime, int confidence)
   return -1;
 }
 
+// Make pid a periodic EDF process: a job of runtime ticks every
+// period ticks, each due deadline ticks after its release.  It is
+// admitted only if the EDF utilization of its run queue, counted
+// as runtime / deadline, stays within EDF_BOUND.
+int set_edf_params(int pid, int runtime, int period, int deadline)
+{
+  struct proc *p;
+  struct runqueue *rq;
+  struct edf_info *e;
+  int util, old, queued;
+
+  if (runtime <= 0 || deadline < runtime || period < deadline)
+    return -1;
+  util = (runtime * 1000 + deadline - 1) / deadline;
+  acquire(&ptable.lock);
+  for (p = ptable.proc; p < &ptable.proc[NPROC]; p++)
+  {
+    if (p->pid != pid || p->state == UNUSED || p->state == ZOMBIE)
+      continue;
+    rq = acquireprocrq(p);
+    e = &p->sched_info.edf;
+    old = p->sched_info.queue == EDF ? e->util : 0;
+    if (rq->edf_util - old + util > EDF_BOUND)
+    {
+      release(&rq->lock);
+      break;
+    }
+    queued = p->on_rq;
+    if (queued)
+      rq_dequeue(rq, p);
+    rq->edf_util += util - old;
+    p->sched_info.queue = EDF;
+    e->runtime = runtime;
+    e->period = period;
+    e->deadline = deadline;
+    e->util = util;
+    e->budget = runtime;
+    e->release = ticks;
+    e->deadline_at = ticks + deadline;
+    e->done = 0;
+    e->jobs = 1;
+    e->misses = 0;
+    if (queued)
+      rq_enqueue(rq, p);
+    release(&rq->lock);
+    release(&ptable.lock);
+    return 0;
+  }
+  release(&ptable.lock);
+  return -1;
+}
+
+// Copy the CPU time used by pid to *t.
+int getcputime(int pid, struct proctime *t)
+{
+  struct proc *p;
+
+  acquire(&ptable.lock);
+  for (p = ptable.proc; p < &ptable.proc[NPROC]; p++)
+  {
+    if (p->pid == pid && p->state != UNUSED)
+    {
+      t->user_sec = p->sched_info.utime.sec;
+      t->user_usec = p->sched_info.utime.usec;
+      t->sys_sec = p->sched_info.stime.sec;
+      t->sys_usec = p->sched_info.stime.usec;
+      release(&ptable.lock);
+      return 0;
+    }
+  }
+  release(&ptable.lock);
+  return -1;
+}
+
+// Copy the latency histograms of every CPU to *st.
+int getschedstat(struct schedstat *st)
+{
+  struct runqueue *rq;
+  int i;
+
+  st->ncpu = ncpu;
+  st->tsc_per_tick = tsc_per_tick;
+  for (i = 0; i < ncpu; i++)
+  {
+    rq = &runqueues[i];
+    acquire(&rq->lock);
+    memmove(st->hist[i], rq->hist, sizeof(rq->hist));
+    release(&rq->lock);
+  }
+  return 0;
+}
+
+// Restrict pid to the CPUs in mask.  If it may not stay where
+// it is, it moves now, or when it next stops running.  EDF
+// processes cannot leave the CPU they were admitted on.
+int set_affinity(int pid, uint mask)
+{
+  struct proc *p;
+  struct runqueue *rq;
+
+  mask &= (1 << ncpu) - 1;
+  if (mask == 0)
+    return -1;
+  acquire(&ptable.lock);
+  for (p = ptable.proc; p < &ptable.proc[NPROC]; p++)
+  {
+    if (p->pid != pid || p->state == UNUSED || p->state == ZOMBIE)
+      continue;
+    rq = acquireprocrq(p);
+    if (p->sched_info.queue == EDF && !(mask & (1 << p->cpu)))
+    {
+      release(&rq->lock);
+      break;
+    }
+    p->affinity = mask;
+    // A RUNNABLE p that is not queued is being moved by another
+    // CPU; like a running one, it moves again after it runs.
+    if (!(mask & (1 << p->cpu)) &&
+        ((p->state == RUNNABLE && p->on_rq) || p->state == SLEEPING))
+      push_away(rq, p);
+    else
+      release(&rq->lock);
+    release(&ptable.lock);
+    return 0;
+  }
+  release(&ptable.lock);
+  return -1;
+}
+
+// Move pid to process group gid.  Its children inherit it.
+int set_group(int pid, int gid)
+{
+  struct proc *p;
+  struct runqueue *rq;
+
+  if (gid < 0 || gid >= NGROUP)
+    return -1;
+  acquire(&ptable.lock);
+  for (p = ptable.proc; p < &ptable.proc[NPROC]; p++)
+  {
+    if (p->pid != pid || p->state == UNUSED || p->state == ZOMBIE)
+      continue;
+    rq = acquireprocrq(p);
+    p->group = gid;
+    release(&rq->lock);
+    release(&ptable.lock);
+    return 0;
+  }
+  release(&ptable.lock);
+  return -1;
+}
+
+// Let group gid use quota_ms of CPU time in every period_ms, or
+// remove its quota if quota_ms is 0.  Across CPUs a group can use
+// up to ncpu times its period.
+int set_group_quota(int gid, int quota_ms, int period_ms)
+{
+  struct group *g;
+
+  if (gid <= 0 || gid >= NGROUP || quota_ms < 0 ||
+      (quota_ms > 0 && (period_ms <= 0 || period_ms > 1000000 ||
+                        quota_ms > period_ms * ncpu)))
+    return -1;
+  g = &groups.group[gid];
+  acquire(&groups.lock);
+  g->quota_ms = quota_ms;
+  g->period_ms = quota_ms > 0 ? period_ms : 0;
+  g->period_start = rdtsc();
+  g->used_us = 0;
+  g->throttled = 0;
+  release(&groups.lock);
+  return 0;
+}
+
+// Set the STRIDE tickets pid holds of its own.
+int set_tickets(int pid, int tickets)
+{
+  struct proc *p;
+  struct runqueue *rq;
+
+  if (tickets < 1 || tickets > MAX_TICKETS)
+    return -1;
+  acquire(&ptable.lock);
+  for (p = ptable.proc; p < &ptable.proc[NPROC]; p++)
+  {
+    if (p->pid == pid && p->state != UNUSED)
+    {
+      rq = acquireprocrq(p);
+      p->sched_info.stride.tickets = tickets;
+      set_stride(p);
+      release(&rq->lock);
+      release(&ptable.lock);
+      return 0;
+    }
+  }
+  release(&ptable.lock);
+  return -1;
+}
+
+// Lend amount of the caller's own tickets to pid, typically a
+// server it is about to block on, ending any loan it had made
+// before.  An amount of 0 just ends the current loan.  The caller
+// keeps at least one ticket.
+int transfer_tickets(int pid, int amount)
+{
+  struct proc *curproc = myproc();
+  struct proc *p;
+  struct runqueue *rq;
+
+  if (amount < 0 || amount >= curproc->sched_info.stride.tickets)
+    return -1;
+  acquire(&ptable.lock);
+  end_loan(curproc);
+  if (amount == 0)
+  {
+    release(&ptable.lock);
+    return 0;
+  }
+  for (p = ptable.proc; p < &ptable.proc[NPROC]; p++)
+  {
+    if (p->pid == pid && p != curproc &&
+        p->state != UNUSED && p->state != ZOMBIE)
+    {
+      rq = acquireprocrq(p);
+      p->sched_info.stride.borrowed += amount;
+      set_stride(p);
+      release(&rq->lock);
+
+      rq = acquireprocrq(curproc);
+      curproc->sched_info.stride.lent_to = p;
+      curproc->sched_info.stride.lent = amount;
+      set_stride(curproc);
+      release(&rq->lock);
+      release(&ptable.lock);
+      return 0;
+    }
+  }
+  release(&ptable.lock);
+  return -1;
+}
+
+// Set the class windows, ROUND_ROBIN and STRIDE quantum and
+// aging threshold of one CPU, or of every CPU if cpu is -1.
+// The shares are in ticks and the period is their sum.  Every
+// share must be positive: pick_next() never runs a class with
+// none, so its processes would starve, and keep the CPU from
+// going idle.
+int tune_scheduler(int cpu, int rr_share, int sjf_share, int fcfs_share,
+                   int stride_share, int rr_quantum, int aging_threshold)
+{
+  struct runqueue *rq;
+  struct cpu *c;
+  int period;
+
+  if (cpu < -1 || cpu >= ncpu)
+    return -1;
+  if (rr_share <= 0 || sjf_share <= 0 || fcfs_share <= 0 || stride_share <= 0)
+    return -1;
+  period = rr_share + sjf_share + fcfs_share + stride_share;
+  if (rr_quantum <= 0 || aging_threshold <= 0)
+    return -1;
+
+  for (c = cpus; c < cpus + ncpu; c++)
+  {
+    if (cpu != -1 && c != &cpus[cpu])
+      continue;
+    // scheduler() reads the settings under the run queue lock.
+    rq = &runqueues[c - cpus];
+    acquire(&rq->lock);
+    c->tune.period = period;
+    c->tune.share[ROUND_ROBIN] = rr_share;
+    c->tune.share[SJF] = sjf_share;
+    c->tune.share[FCFS] = fcfs_share;
+    c->tune.share[STRIDE] = stride_share;
+    c->tune.rr_quantum = rr_quantum;
+    c->tune.aging_threshold = aging_threshold;
+    release(&rq->lock);
+  }
+  return 0;
+}
 
 void print_processes_info()
 {
@@ -817,7 +2888,7 @@ void print_processes_info()
       [RUNNING] "running",
       [ZOMBIE] "zombie"};
 
-  static int columns[] = {16, 6, 11, 8, 12, 13, 13, 18, 11};
+  static int columns[] = {16, 6, 11, 8, 12, 13, 13, 12, 10, 10, 5, 10, 18, 11};
   cprintf("name");
   print_blank(columns[0] - strlen("name"));
   cprintf("pid");
@@ -832,12 +2903,22 @@ void print_processes_info()
   print_blank(columns[5] - strlen("confidence"));
   cprintf("burst_time");
   print_blank(columns[6] - strlen("burst_time"));
+  cprintf("predicted");
+  print_blank(columns[7] - strlen("predicted"));
+  cprintf("tickets");
+  print_blank(columns[8] - strlen("tickets"));
+  cprintf("up/down");
+  print_blank(columns[9] - strlen("up/down"));
+  cprintf("cpu");
+  print_blank(columns[10] - strlen("cpu"));
+  cprintf("migrated");
+  print_blank(columns[11] - strlen("migrated"));
   cprintf("consecutive_run");
-  print_blank(columns[7] - strlen("consecutive_run"));
+  print_blank(columns[12] - strlen("consecutive_run"));
   cprintf("Arrival");
-  print_blank(columns[8] - strlen("Arrival"));
+  print_blank(columns[13] - strlen("Arrival"));
   cprintf("\n");
-  cprintf("------------------------------------------------------------------------------------------------------------\n");
+  cprintf("-----------------------------------------------------------------------------------------------------------------------------------------------------------\n");
 
   struct proc *p;
   for (p = ptable.proc; p < &ptable.proc[NPROC]; p++)
@@ -876,14 +2957,90 @@ void print_processes_info()
     cprintf("%d", (int)p->sched_info.sjf.BurstTime);
     print_blank(columns[6] - find_length((int)p->sched_info.sjf.BurstTime));
 
+    int predicted = p->sched_info.sjf.predicted;
+    cprintf("%d.%d%d%s", predicted / 100, predicted / 10 % 10, predicted % 10,
+            p->sched_info.sjf.auto_burst ? "" : "*");
+    print_blank(columns[7] - find_length(predicted / 100) - 3 - !p->sched_info.sjf.auto_burst);
+
+    struct stride_info *s = &p->sched_info.stride;
+    int tickets = s->tickets - s->lent + s->borrowed;
+    cprintf("%d", tickets);
+    print_blank(columns[8] - find_length(tickets));
+
+    cprintf("%d/%d", p->sched_info.promotions, p->sched_info.demotions);
+    print_blank(columns[9] - find_length(p->sched_info.promotions) - 1 -
+                find_length(p->sched_info.demotions));
+
+    cprintf("%d", p->last_cpu);
+    print_blank(columns[10] - find_length(p->last_cpu) - (p->last_cpu < 0));
+
+    cprintf("%d", p->migrations);
+    print_blank(columns[11] - find_length(p->migrations));
+
     cprintf("%d", (int)p->consecutive_time);
-    print_blank(columns[7] - find_length((int)p->consecutive_time));
+    print_blank(columns[12] - find_length((int)p->consecutive_time));
 
     cprintf("%d", p->sched_info.sjf.arrival_time);
-    print_blank(columns[8] - find_length(p->sched_info.sjf.arrival_time));
+    print_blank(columns[13] - find_length(p->sched_info.sjf.arrival_time));
 
     cprintf("\n");
   }
+
+  struct cpu *c;
+  for (c = cpus; c < cpus + ncpu; c++)
+  {
+    int busy = c->timer_ticks - c->idle_ticks;
+    cprintf("cpu%d: period %d (RR %d, SJF %d, FCFS %d, STRIDE %d) quantum %d aging %d | ",
+            (int)(c - cpus), c->tune.period, c->tune.share[ROUND_ROBIN],
+            c->tune.share[SJF], c->tune.share[FCFS], c->tune.share[STRIDE],
+            c->tune.rr_quantum, c->tune.aging_threshold);
+    cprintf("busy %d of %d ticks (%d%%), idle %d | edf %d.%d%% | kpreempt %d\n",
+            busy, c->timer_ticks, c->timer_ticks ? busy * 100 / c->timer_ticks : 0,
+            c->idle_ticks, runqueues[c - cpus].edf_util / 10,
+            runqueues[c - cpus].edf_util % 10, c->kpreempts);
+  }
+
+  for (int i = 0; i < NUM_SHARED_MEMORY; i++)
+  {
+    struct gang *g = &gangs.gang[i];
+    if (!g->enabled)
+      continue;
+    cprintf("gang %d: %d members | slots %d, joined %d, pulled %d, preempted %d\n",
+            i, g->nmembers, g->slots, g->joins, g->pulls, g->preempts);
+  }
+
+  for (int i = 1; i < NGROUP; i++)
+  {
+    struct group *g = &groups.group[i];
+    if (g->quota_ms == 0 && g->nthrottled == 0)
+      continue;
+    cprintf("group %d: quota %d/%d ms | used %d us, throttled %d times | pids",
+            i, g->quota_ms, g->period_ms, g->used_us, g->nthrottled);
+    for (p = ptable.proc; p < &ptable.proc[NPROC]; p++)
+      if (p->group == i && p->state != UNUSED)
+        cprintf(" %d%s", p->pid, p->throttled ? "*" : "");
+    cprintf("\n");
+  }
+
+  for (p = ptable.proc; p < &ptable.proc[NPROC]; p++)
+  {
+    struct edf_info *e = &p->sched_info.edf;
+    if (p->state == UNUSED || p->sched_info.queue != EDF)
+      continue;
+    cprintf("edf %s (pid %d, cpu%d): runtime %d period %d deadline %d | jobs %d, missed %d\n",
+            p->name, p->pid, p->cpu, e->runtime, e->period, e->deadline,
+            e->jobs, e->misses);
+  }
+
+  for (p = ptable.proc; p < &ptable.proc[NPROC]; p++)
+  {
+    struct schedule_info *s = &p->sched_info;
+    if (p->state == UNUSED || s->boosts == 0)
+      continue;
+    cprintf("inherit %s (pid %d): boosted %d times for %d us%s\n",
+            p->name, p->pid, s->boosts, s->boost_us,
+            s->nboost > 0 ? ", boosted now" : "");
+  }
 }
 
 void create_palindrome(int num) {
@@ -1,6 +1,34 @@
 #define MAX_SYSCALLS 50
-#define AGING_THRESHOLD 800
+#define AGING_THRESHOLD 800   // default ticks waited before promotion
+#define AGING_WHEEL 1024      // aging timer wheel slots per CPU (power of 2)
 #define NUM_SHARED_MEMORY 64 
+#define SCHED_PERIOD 70       // default ticks in a scheduling period
+#define RR_SHARE 30           // default ticks of the period per class
+#define SJF_SHARE 20
+#define FCFS_SHARE 10
+#define STRIDE_SHARE 10
+#define RR_QUANTUM 5          // default ROUND_ROBIN and STRIDE time slice in ticks
+#define DEFAULT_TICKETS 100   // STRIDE tickets of a new process
+#define MAX_TICKETS 10000
+#define STRIDE1 (1 << 20)     // stride of a process holding one ticket
+#define EDF_BOUND 900         // admitted EDF utilization per CPU, per mille
+#define MLFQ_RESET 1000       // ticks between moves of every level to the top
+#define MIGRATE_HOT 2         // ticks after running that a process is cache-hot
+#define NWAITQ 64             // wait channel hash buckets (power of 2)
+#define NGROUP 16             // process groups; group 0 has no quota
+
+enum schedule_queue {UNSET, ROUND_ROBIN, SJF, FCFS, STRIDE, EDF, NQUEUE};
+
+// Scheduler settings, per CPU.  Each period is divided into
+// consecutive windows, one per class in enum order, of
+// share[class] ticks; the shares add up to period.  EDF has
+// no window: its jobs run ahead of every class.
+struct sched_tunables {
+  int period;
+  int share[NQUEUE];
+  int rr_quantum;
+  int aging_threshold;
+};
 
 // Per-CPU state
 struct cpu {
@@ -14,6 +42,13 @@ struct cpu {
   struct proc *proc;           // The process running on this cpu or null
   int cpu_ticks;
   int syscall_count;
+  volatile uint idle;          // Halted in scheduler() with nothing to run?
+  uint timer_ticks;            // Timer interrupts taken by this CPU
+  uint idle_ticks;             // ...of which arrived while it was halted
+  struct sched_tunables tune;  // Class windows and slice lengths
+  volatile int gang_call;      // 1 + gang to run a member of, sent by IPI
+  volatile int need_resched;   // A queued process outranks the running one
+  uint kpreempts;              // Yields at cond_resched() checkpoints
 };
 
 extern struct cpu cpus[NCPU];
@@ -46,22 +81,109 @@ struct syscall_info {
     const char* name;   // Name of syscall
 };
 
-enum schedule_queue {UNSET, ROUND_ROBIN, SJF, FCFS};
+// CPU time, kept in microseconds with the cycles that do not
+// yet make up a whole one.
+struct cputime {
+  uint sec;
+  uint usec;
+  uint cycles;
+};
 
 struct sjf_info {
   int arrival_time;
   int Confidence;
   int BurstTime;
+  int predicted;      // Exponential average of measured bursts, 1/100 ticks
+  int alpha;          // Weight of the newest burst, in percent
+  int auto_burst;     // If non-zero, BurstTime follows predicted
+};
+
+// Stride scheduling: each tick a STRIDE process runs advances its
+// pass by its stride, STRIDE1 / tickets, and the lowest pass runs
+// next, so CPU time is shared in proportion to tickets.  A process
+// can lend some of its tickets to another one, e.g. a client
+// blocked on a server; the loan lasts until the lender ends it
+// or either process exits.  Loans are protected by ptable.lock,
+// stride and pass by the process's run queue lock.
+struct stride_info {
+  int tickets;        // Own tickets
+  int lent;           // ...of which are lent to lent_to
+  int borrowed;       // Tickets lent to us by other processes
+  struct proc *lent_to;
+  uint stride;
+  uint pass;
 };
 
+// A periodic EDF process is released a job of runtime ticks
+// every period ticks, due deadline ticks after its release.  A
+// job ends when the process blocks; one still unfinished by its
+// deadline is a miss.  A job that used up its runtime waits for
+// the next release.  Protected by the process's run queue lock.
+struct edf_info {
+  int runtime;
+  int period;
+  int deadline;
+  int util;           // runtime / deadline, per mille
+  int budget;         // Ticks left for the current job
+  uint release;       // Release time of the current job
+  uint deadline_at;   // ...and its absolute deadline
+  int done;           // Has the current job ended?
+  int jobs;
+  int misses;
+};
+
+// ROUND_ROBIN, SJF and FCFS are the levels of a multi-level
+// feedback queue, top to bottom.  A process starts at the top,
+// moves down a level when it uses a whole slice (mlfq_slice())
+// and up one when it blocks before that.  Aging and the periodic
+// reset move waiting processes back up.  sh and init are pinned
+// to ROUND_ROBIN.
 struct schedule_info {
   enum schedule_queue queue;
+  uint64 runnable_tsc;  // TSC when last made RUNNABLE
+  uint64 running_tsc;   // ...and when last dispatched
+  uint64 acct_tsc;      // Last time CPU time was charged
+  struct cputime utime; // CPU time in user mode
+  struct cputime stime; // ...and in the kernel
+  int dispatch_queue;   // Class it was last dispatched from
+  int pinned;         // Exempt from MLFQ moves
+  uint mlfq_epoch;    // Reset period of the last move to the top
+  int promotions;     // MLFQ level changes up...
+  int demotions;      // ...and down
   int last_run;
   struct sjf_info sjf;
+  struct stride_info stride;
+  struct edf_info edf;
+  int base_queue;     // Class to return to when no longer boosted
+  int nboost;         // Held sleeplocks it was boosted for
+  uint64 boost_tsc;   // TSC when first boosted
+  int boosts;         // Times a waiter boosted it
+  uint boost_us;      // Time spent boosted
   int arrival_queue_time;
   int get_cpu_time;
 };
 
+// A program segment, read in from the executable a page at a
+// time as it is first touched.
+struct segment {
+  uint va;                     // Start, page aligned
+  uint memsz;
+  uint off;                    // File offset of va
+  uint filesz;
+  uint flags;                  // ELF_PROG_FLAG_*
+};
+
+// A program loaded by loaduser(), for exec() and spawn().
+struct image {
+  pde_t *pgdir;
+  uint sz;
+  uint sp;
+  uint entry;
+  struct inode *exe;           // Executable its segments come from
+  int nseg;
+  struct segment seg[NSEG];
+};
+
 typedef struct SharedMemory {
   int mem_id;
   uint key;
@@ -80,6 +202,8 @@ struct proc {
   struct trapframe *tf;        // Trap frame for current syscall
   struct context *context;     // swtch() here to run process
   void *chan;                  // If non-zero, sleeping on chan
+  struct proc *wq_next;        // Wait queue links
+  struct proc *wq_prev;
   int killed;                  // If non-zero, have been killed
   struct file *ofile[NOFILE];  // Open files
   struct inode *cwd;           // Current directory
@@ -90,6 +214,23 @@ struct proc {
   int consecutive_time;
   struct schedule_info sched_info;
   SharedMemory pages[NUM_SHARED_MEMORY];
+  int cpu;                     // Run queue this process belongs to
+  int last_cpu;                // CPU that last ran it, or -1
+  uint affinity;               // Bit mask of the CPUs it may run on
+  int migrations;              // Times it ran on a CPU other than last_cpu
+  int on_rq;                   // If non-zero, linked on its run queue
+  struct proc *rq_next;        // Ready list links (ROUND_ROBIN, FCFS)
+  struct proc *rq_prev;
+  int heap_index;              // Slot in the SJF, STRIDE or EDF ready heap
+  struct proc *age_next;       // Aging timer wheel links
+  struct proc *age_prev;
+  uint age_expiry;             // Tick at which a queued process is promoted
+  int gang;                    // Gang (shared memory region) it belongs to, or -1
+  int group;                   // Process group charged for its CPU time
+  int throttled;               // If non-zero, queued on its run queue's throttled list
+  struct inode *exe;           // Executable its segments are paged in from
+  int nseg;
+  struct segment seg[NSEG];
 };
 
 // Process memory is laid out contiguously, low addresses first:
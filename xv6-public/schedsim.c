@@ -0,0 +1,422 @@
+// Host-side scheduler simulator.
+//
+// Builds proc.c itself, against a mock process table, tick and
+// TSC, so that the run queues, pick_next() and with it
+// round_robin(), shortest_job_first(), first_come_first_serve(),
+// stride_scheduling(), earliest_deadline_first() and
+// aging_process() make the decisions they would make in the
+// kernel.  The timer tick and the bookkeeping of a process that
+// is preempted or blocks come from the proc.c functions trap(),
+// yield() and sleep() use: timer_tick(), requeue_current() and
+// block_current().
+//
+// Workloads come from a trace file, one process per line:
+//
+//   <arrival tick> <RR|SJF|FCFS|STRIDE|EDF> <cpu ticks> [<burst> <io ticks>]
+//
+// A process runs for burst ticks at a time, then blocks for io
+// ticks, until it has had cpu ticks in all.  An EDF process must
+// have a burst: it gets burst ticks in every period of burst+io
+// ticks, or runs as RR if admission control refuses it.  Lines
+// starting with # are ignored.  Or a workload is generated:
+//
+//   schedsim [-c ncpu] [-n nproc] [-s seed] [trace]
+//
+// Results are reported by the class each process arrived in, so
+// MLFQ and aging moves count against where a process started.
+// The same trace and seed always give the same results.  Only
+// NPROC processes exist at a time; later arrivals wait for a
+// slot, as a failed fork() would be retried.
+
+#define SCHEDSIM
+
+// Kernel functions whose names the C library also uses.
+#define exit kexit
+#define fork kfork
+#define wait kwait
+#define sleep ksleep
+#define kill kkill
+#define memset kmemset
+#define memmove kmemmove
+
+#include "types.h"
+
+// The instructions proc.c uses; x86.h leaves them out.
+static uint64 sim_tsc;
+static int sim_cpu;
+
+static inline uint readeflags(void) { return 0; }
+static inline void cli(void) { }
+static inline void sti(void) { }
+static inline void sti_hlt(void) { }
+static inline uint64 rdtsc(void) { return sim_tsc; }
+
+#include "proc.c"
+
+#undef exit
+#undef fork
+#undef wait
+#undef sleep
+#undef kill
+#undef memset
+#undef memmove
+
+// Not <string.h>: defs.h declares the kernel's versions.
+#include <stdio.h>
+#include <stdlib.h>
+
+#define SIM_TSC_PER_TICK 1000000
+#define SIM_MAXPROC 100000
+
+struct cpu cpus[NCPU];
+int ncpu = 1;
+uint ticks;
+struct spinlock tickslock;
+uint tsc_per_us = SIM_TSC_PER_TICK / 10000;
+uint tsc_per_tick = SIM_TSC_PER_TICK;
+
+// The rest of the kernel, as far as proc.c needs it.
+void cprintf(char *fmt, ...) { }
+void panic(char *s) { fprintf(stderr, "schedsim: panic: %s\n", s); abort(); }
+void initlock(struct spinlock *lk, char *name) { }
+void acquire(struct spinlock *lk) { }
+void release(struct spinlock *lk) { }
+int holding(struct spinlock *lk) { return 1; }
+void pushcli(void) { cpus[sim_cpu].ncli++; }
+void popcli(void) { cpus[sim_cpu].ncli--; }
+int lapicid(void) { return sim_cpu; }
+void lapicipi(int apicid, int vector) { }
+char *kalloc(void) { return calloc(1, PGSIZE); }
+void kfree(char *v) { free(v); }
+void *kmemset(void *dst, int c, uint n) { return __builtin_memset(dst, c, n); }
+void *kmemmove(void *dst, const void *src, uint n) { return __builtin_memmove(dst, src, n); }
+char *safestrcpy(char *s, const char *t, int n)
+{
+  char *os = s;
+
+  while(--n > 0 && (*s++ = *t++) != 0)
+    ;
+  *s = 0;
+  return os;
+}
+void switchuvm(struct proc *p) { }
+void switchkvm(void) { }
+void swtch(struct context **old, struct context *new) { panic("swtch"); }
+pde_t *setupkvm(void) { return 0; }
+int allocuvm(pde_t *pgdir, uint oldsz, uint newsz) { return 0; }
+int deallocuvm(pde_t *pgdir, uint oldsz, uint newsz) { return 0; }
+void freevm(pde_t *pgdir) { }
+pde_t *copyuvm(pde_t *pgdir, uint sz) { return 0; }
+int loaduser(char *path, char **argv, struct image *img) { return -1; }
+void setimage(struct proc *p, struct image *img) { }
+void clearpteu(pde_t *pgdir, char *uva) { }
+struct inode *namei(char *path) { return 0; }
+struct inode *idup(struct inode *ip) { return ip; }
+void iput(struct inode *ip) { }
+void iinit(int dev) { }
+void initlog(int dev) { }
+void begin_op(void) { }
+void end_op(void) { }
+struct file *filedup(struct file *f) { return f; }
+void fileclose(struct file *f) { }
+void map_pages_wrapper(struct proc *p, int index, int i) { }
+void close_shared_memory_wrapper(void *p) { }
+void print_blank(int count) { }
+int find_length(int n) { return 1; }
+
+static char *classes[] = {"", "RR", "SJF", "FCFS", "STRIDE", "EDF"};
+
+struct job {
+  int arrival;
+  int queue;
+  int cpu;                     // CPU ticks needed in all
+  int burst;                   // Ticks run before each block, or 0
+  int io;                      // Ticks blocked each time
+  // Filled in as it runs
+  struct proc *p;
+  int ran;                     // CPU ticks had so far
+  int in_burst;                // ...since it last blocked
+  int io_total;
+  int wake_at;
+  int finish;
+  int misses;                  // EDF deadlines missed
+};
+
+static struct job *jobs;
+static int njobs;
+static int edf_refused;        // EDF jobs run as RR instead
+
+static void
+add_job(int arrival, int queue, int cpu, int burst, int io)
+{
+  struct job *j;
+
+  if(njobs == SIM_MAXPROC || cpu <= 0)
+    return;
+  if(queue == EDF && (burst <= 0 || io <= 0)){
+    fprintf(stderr, "schedsim: EDF process without a burst\n");
+    return;
+  }
+  j = &jobs[njobs++];
+  j->arrival = arrival;
+  j->queue = queue;
+  j->cpu = cpu;
+  j->burst = burst > 0 && io > 0 ? burst : 0;
+  j->io = j->burst ? io : 0;
+}
+
+static int
+read_trace(char *path)
+{
+  FILE *f = fopen(path, "r");
+  char line[256], cls[16];
+  int arrival, cpu, burst, io, n, q;
+
+  if(f == 0)
+    return -1;
+  while(fgets(line, sizeof line, f)){
+    if(line[0] == '#')
+      continue;
+    burst = io = 0;
+    n = sscanf(line, "%d %15s %d %d %d", &arrival, cls, &cpu, &burst, &io);
+    if(n < 3)
+      continue;
+    for(q = ROUND_ROBIN; q <= EDF; q++)
+      if(compare_string(cls, classes[q]))
+        break;
+    if(q > EDF){
+      fprintf(stderr, "schedsim: unknown class %s\n", cls);
+      continue;
+    }
+    add_job(arrival, q, cpu, burst, io);
+  }
+  fclose(f);
+  return 0;
+}
+
+// A mix of short interactive jobs and long CPU-bound ones in
+// every class, arriving at random over a span that loads the
+// CPUs to about 90%.  EDF jobs are all periodic, interactive ones.
+static void
+gen_trace(int n, uint seed)
+{
+  int i, q, interactive;
+
+  srand(seed);
+  for(i = 0; i < n; i++){
+    q = ROUND_ROBIN + rand() % 5;
+    interactive = q == EDF || rand() % 2;
+    add_job(rand() % (n * 240 / ncpu), q,
+            interactive ? 5 + rand() % 30 : 50 + rand() % 300,
+            interactive ? 1 + rand() % 3 : 0, interactive ? 5 + rand() % 20 : 0);
+  }
+}
+
+static int
+by_arrival(const void *a, const void *b)
+{
+  return ((struct job*)a)->arrival - ((struct job*)b)->arrival;
+}
+
+// A free proc slot for job j, set up as fork() and exec() would.
+static struct proc*
+start(struct job *j)
+{
+  struct proc *p = allocproc();
+
+  if(p == 0)
+    return 0;
+  safestrcpy(p->name, classes[j->queue], sizeof p->name);
+  p->sched_info.queue = j->queue;
+  p->sched_info.arrival_queue_time = ticks;
+  p->sched_info.sjf.arrival_time = ticks;
+  p->sched_info.last_run = ticks;
+  p->affinity = (1 << ncpu) - 1;
+  set_stride(p);
+  p->cpu = affine_rq(p) - runqueues;
+  if(j->queue == EDF &&
+     set_edf_params(p->pid, j->burst, j->burst + j->io, j->burst + j->io) < 0){
+    p->sched_info.queue = ROUND_ROBIN;
+    j->queue = ROUND_ROBIN;
+    edf_refused++;
+  }
+  j->p = p;
+  return p;
+}
+
+// Free p's slot, as wait() would after exit().
+static void
+finish(struct proc *p)
+{
+  kfree(p->kstack);
+  p->kstack = 0;
+  p->state = UNUSED;
+}
+
+// The CPU-side half of sched(), once p has stopped running on c.
+static void
+stop(struct runqueue *rq, struct cpu *c, struct proc *p)
+{
+  undispatch(rq, p);
+  c->proc = 0;
+}
+
+static struct job *running_job[NPROC];
+
+static struct job*
+job_of(struct proc *p)
+{
+  return running_job[p - ptable.proc];
+}
+
+struct classstat {
+  int n;
+  double turnaround, waiting, maxwait;
+  double sum, sumsq;           // Of slowdown, for Jain's index
+};
+
+static void
+report(uint end)
+{
+  struct classstat st[EDF + 1] = {{0}}, *s;
+  struct job *j;
+  double t, w, slow;
+  int q, done = 0, misses = 0;
+
+  for(j = jobs; j < jobs + njobs; j++){
+    if(j->finish == 0)
+      continue;
+    s = &st[j->queue];
+    t = j->finish - j->arrival;
+    w = t - j->cpu - j->io_total;
+    slow = t / (j->cpu + j->io_total);
+    s->n++;
+    s->turnaround += t;
+    s->waiting += w;
+    if(w > s->maxwait)
+      s->maxwait = w;
+    s->sum += slow;
+    s->sumsq += slow * slow;
+    misses += j->misses;
+    done++;
+  }
+  printf("%d of %d processes finished in %u ticks on %d cpu(s): %.2f per 100 ticks\n",
+         done, njobs, end, ncpu, end ? done * 100.0 / end : 0.0);
+  printf("%-7s %6s %12s %12s %12s %9s %10s\n", "class", "n",
+         "turnaround", "waiting", "max wait", "fairness", "per 100t");
+  for(q = ROUND_ROBIN; q <= EDF; q++){
+    s = &st[q];
+    if(s->n == 0)
+      continue;
+    printf("%-7s %6d %12.1f %12.1f %12.0f %9.3f %10.2f\n", classes[q], s->n,
+           s->turnaround / s->n, s->waiting / s->n, s->maxwait,
+           s->sum * s->sum / (s->n * s->sumsq), end ? s->n * 100.0 / end : 0.0);
+  }
+  if(st[EDF].n || edf_refused)
+    printf("EDF: %d deadline(s) missed, %d process(es) refused and run as RR\n",
+           misses, edf_refused);
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct runqueue *rq;
+  struct cpu *c;
+  struct proc *p;
+  struct job *j, *next;
+  int i, n = 200, left;
+  uint seed = 1;
+  char *trace = 0;
+
+  for(i = 1; i < argc; i++){
+    if(compare_string(argv[i], "-c") && i + 1 < argc)
+      ncpu = atoi(argv[++i]);
+    else if(compare_string(argv[i], "-n") && i + 1 < argc)
+      n = atoi(argv[++i]);
+    else if(compare_string(argv[i], "-s") && i + 1 < argc)
+      seed = atoi(argv[++i]);
+    else if(argv[i][0] == '-'){
+      fprintf(stderr, "usage: schedsim [-c ncpu] [-n nproc] [-s seed] [trace]\n");
+      return 1;
+    } else
+      trace = argv[i];
+  }
+  if(ncpu < 1 || ncpu > NCPU)
+    ncpu = 1;
+  jobs = calloc(SIM_MAXPROC, sizeof *jobs);
+  if(trace ? read_trace(trace) < 0 : (gen_trace(n, seed), 0)){
+    fprintf(stderr, "schedsim: cannot read %s\n", trace);
+    return 1;
+  }
+  qsort(jobs, njobs, sizeof *jobs, by_arrival);
+
+  pinit();
+  for(i = 0; i < ncpu; i++){
+    cpus[i].apicid = i;
+    runqueues[i].seed = seed * 0x9E3779B9 + i + 1;
+  }
+
+  next = jobs;
+  left = njobs;
+  while(left > 0){
+    ticks++;
+    sim_tsc = (uint64)ticks * SIM_TSC_PER_TICK;
+
+    for(j = jobs; j < next; j++){
+      if(j->p && j->p->state == SLEEPING && j->wake_at == ticks){
+        rq = &runqueues[j->p->cpu];
+        makerunnable(rq, j->p);
+      }
+    }
+    for(; next < jobs + njobs && next->arrival <= ticks; next++){
+      if((p = start(next)) == 0)
+        break;
+      running_job[p - ptable.proc] = next;
+      makerunnable(&runqueues[p->cpu], p);
+    }
+
+    // The tick on each running CPU.
+    for(sim_cpu = 0; sim_cpu < ncpu; sim_cpu++){
+      c = &cpus[sim_cpu];
+      rq = &runqueues[sim_cpu];
+      if((p = c->proc) == 0)
+        continue;
+      j = job_of(p);
+      j->ran++;
+      j->in_burst++;
+      if(j->ran >= j->cpu){
+        j->misses = p->sched_info.edf.misses;
+        exit_current(rq, p);
+        stop(rq, c, p);
+        j->finish = ticks;
+        j->p = 0;
+        finish(p);
+        left--;
+      } else if(j->burst && j->in_burst >= j->burst){
+        block_current(c, p);
+        stop(rq, c, p);
+        j->in_burst = 0;
+        j->io_total += j->io;
+        j->wake_at = ticks + j->io;
+      } else if(timer_tick(c, p)){
+        requeue_current(rq, c, p, 1);
+        stop(rq, c, p);
+      }
+    }
+
+    // Idle CPUs look for work, as scheduler() does.
+    for(sim_cpu = 0; sim_cpu < ncpu; sim_cpu++){
+      c = &cpus[sim_cpu];
+      rq = &runqueues[sim_cpu];
+      if(c->proc)
+        continue;
+      if(rq->nrunnable == 0)
+        steal_work(rq);
+      if((p = pick_next(rq, c)) != 0)
+        dispatch(rq, c, p);
+    }
+
+  }
+  report(ticks);
+  return 0;
+}
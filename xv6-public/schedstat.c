@@ -0,0 +1,96 @@
+#include "types.h"
+#include "param.h"
+#include "schedstat.h"
+#include "user.h"
+
+static char *classes[] = {"", "RR", "SJF", "FCFS", "STRIDE", "EDF"};
+
+// Print 2^b cycles as e.g. 512K.
+void print_cycles(int b)
+{
+    static char *units[] = {"", "K", "M", "G", "T"};
+
+    printf(1, "%d%s", 1 << (b % 10), units[b / 10]);
+}
+
+// Upper bound of the bucket holding the pct-th percentile.
+void print_percentile(uint *h, uint total, int pct)
+{
+    uint sum = 0;
+    int b;
+
+    for (b = 0; b < SCHED_NBUCKET - 1; b++) {
+        sum += h[b];
+        if (sum * 100 >= total * pct)
+            break;
+    }
+    printf(1, " <");
+    print_cycles(b + 1);
+}
+
+void print_hist(char *what, uint *h)
+{
+    uint total = 0;
+    int b;
+
+    for (b = 0; b < SCHED_NBUCKET; b++)
+        total += h[b];
+    if (total == 0)
+        return;
+    printf(1, "    %s n=%d p50", what, total);
+    print_percentile(h, total, 50);
+    printf(1, " p90");
+    print_percentile(h, total, 90);
+    printf(1, " p99");
+    print_percentile(h, total, 99);
+    printf(1, "\n");
+}
+
+// Print the user and system time of each pid.
+void print_cputime(int argc, char *argv[])
+{
+    struct proctime t;
+    int i;
+
+    for (i = 1; i < argc; i++) {
+        if (getcputime(atoi(argv[i]), &t) < 0) {
+            printf(1, "pid %s: not found\n", argv[i]);
+            continue;
+        }
+        printf(1, "pid %s: user %d.%d%d%d%d%d%d s, sys %d.%d%d%d%d%d%d s\n", argv[i],
+               t.user_sec, t.user_usec / 100000, t.user_usec / 10000 % 10,
+               t.user_usec / 1000 % 10, t.user_usec / 100 % 10, t.user_usec / 10 % 10,
+               t.user_usec % 10,
+               t.sys_sec, t.sys_usec / 100000, t.sys_usec / 10000 % 10,
+               t.sys_usec / 1000 % 10, t.sys_usec / 100 % 10, t.sys_usec / 10 % 10,
+               t.sys_usec % 10);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    struct schedstat *st;
+    int cpu, q;
+
+    // schedstat <pid>...: CPU time of those processes.
+    if (argc > 1) {
+        print_cputime(argc, argv);
+        exit();
+    }
+    st = malloc(sizeof(*st));
+    if (st == 0 || getschedstat(st) < 0) {
+        printf(2, "schedstat: cannot read scheduler statistics\n");
+        exit();
+    }
+    printf(1, "1 tick = %d cycles\n", st->tsc_per_tick);
+    for (cpu = 0; cpu < st->ncpu; cpu++) {
+        printf(1, "cpu%d:\n", cpu);
+        for (q = 1; q < SCHED_NCLASS; q++) {
+            printf(1, "  %s\n", classes[q]);
+            print_hist("wait ", st->hist[cpu][q].wait);
+            print_hist("slice", st->hist[cpu][q].slice);
+        }
+    }
+    free(st);
+    exit();
+}
@@ -0,0 +1,22 @@
+// Scheduler latency histograms, copied out by getschedstat().
+// Include param.h first.
+
+#define SCHED_NCLASS 6        // enum schedule_queue entries (UNSET unused)
+#define SCHED_NBUCKET 40      // bucket b counts values in [2^b, 2^(b+1)) cycles
+
+struct schedhist {
+  uint wait[SCHED_NBUCKET];   // RUNNABLE until dispatched
+  uint slice[SCHED_NBUCKET];  // Dispatched until switched out
+};
+
+// CPU time used by one process, from getcputime().
+struct proctime {
+  uint user_sec, user_usec;
+  uint sys_sec, sys_usec;
+};
+
+struct schedstat {
+  int ncpu;
+  uint tsc_per_tick;          // TSC cycles per timer tick, averaged
+  struct schedhist hist[NCPU][SCHED_NCLASS];
+};
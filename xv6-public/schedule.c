@@ -1,4 +1,5 @@
 #include "types.h"
+#include "param.h"
 #include "user.h"
 
 void help()
@@ -8,6 +9,14 @@ void help()
     printf(1, "1) info\n");
     printf(1, "2) change_queue <pid> <new_queue>\n");
     printf(1, "3) set_sjf_param <pid> <burst_time> <confidence>\n");
+    printf(1, "4) predict <pid> <on|off> <alpha>\n");
+    printf(1, "5) tune <cpu|all> <rr_share> <sjf_share> <fcfs_share> <stride_share> <quantum> <aging_threshold>\n");
+    printf(1, "6) set_tickets <pid> <tickets>\n");
+    printf(1, "7) edf <pid> <runtime> <period> <deadline>\n");
+    printf(1, "8) affinity <pid> <cpu[,cpu...]|all>\n");
+    printf(1, "9) gang <mem_id> <on|off>\n");
+    printf(1, "10) group <pid> <group>\n");
+    printf(1, "11) quota <group> <quota_ms> <period_ms>\n");
 }
 
 void print_info()
@@ -21,7 +30,7 @@ void change_queue(int pid, int new_queue)
         printf(1, "Invalid pid\n");
         return;
     }
-    if (new_queue < 1 || new_queue > 3) {
+    if (new_queue < 1 || new_queue > 4) {
         printf(1, "Invalid queue\n");
         return;
     }
@@ -51,6 +60,154 @@ void set_sjf_parameters(int pid, int burst_time, int confidence)
 }
 
 
+void set_prediction(int pid, char *mode, int alpha)
+{
+    if (pid < 1) {
+        printf(1, "Invalid pid\n");
+        return;
+    }
+    if ((strcmp(mode, "on") != 0 && strcmp(mode, "off") != 0) || alpha < 0 || alpha > 100) {
+        printf(1, "Invalid params\n");
+        return;
+    }
+    int res = set_burst_prediction(pid, strcmp(mode, "on") == 0, alpha);
+
+    if (res < 0)
+        printf(1, "Error setting burst prediction\n");
+    else
+        printf(1, "Burst prediction has been set successfully\n");
+}
+
+void tune(char *cpu, char *argv[])
+{
+    int target = strcmp(cpu, "all") == 0 ? -1 : atoi(cpu);
+    int rr = atoi(argv[0]), sjf = atoi(argv[1]), fcfs = atoi(argv[2]);
+    int stride = atoi(argv[3]);
+
+    if (rr <= 0 || sjf <= 0 || fcfs <= 0 || stride <= 0) {
+        printf(1, "Every share must be positive\n");
+        return;
+    }
+    int res = tune_scheduler(target, rr, sjf, fcfs, stride, atoi(argv[4]), atoi(argv[5]));
+
+    if (res < 0)
+        printf(1, "Error tuning scheduler\n");
+    else
+        printf(1, "Scheduler has been tuned successfully\n");
+}
+
+void set_process_tickets(int pid, int tickets)
+{
+    if (pid < 1) {
+        printf(1, "Invalid pid\n");
+        return;
+    }
+    if (tickets < 1) {
+        printf(1, "Invalid tickets\n");
+        return;
+    }
+    int res = set_tickets(pid, tickets);
+
+    if (res < 0)
+        printf(1, "Error setting tickets\n");
+    else
+        printf(1, "Tickets have been set successfully\n");
+}
+
+void set_edf(int pid, int runtime, int period, int deadline)
+{
+    if (pid < 1) {
+        printf(1, "Invalid pid\n");
+        return;
+    }
+    if (runtime < 1 || deadline < runtime || period < deadline) {
+        printf(1, "Invalid params\n");
+        return;
+    }
+    int res = set_edf_params(pid, runtime, period, deadline);
+
+    if (res < 0)
+        printf(1, "EDF admission rejected\n");
+    else
+        printf(1, "Process has been admitted to EDF\n");
+}
+
+void affinity(int pid, char *cpus)
+{
+    uint mask = 0;
+    char *s;
+    int cpu;
+
+    if (pid < 1) {
+        printf(1, "Invalid pid\n");
+        return;
+    }
+    if (strcmp(cpus, "all") == 0)
+        mask = ~0;
+    else {
+        for (s = cpus; ; s++) {
+            if (*s < '0' || *s > '9') {
+                printf(1, "Invalid cpu list\n");
+                return;
+            }
+            cpu = atoi(s);
+            while (*s >= '0' && *s <= '9')
+                s++;
+            if (cpu < 0 || cpu >= NCPU) {
+                printf(1, "Invalid cpu %d: must be 0 to %d\n", cpu, NCPU - 1);
+                return;
+            }
+            mask |= 1 << cpu;
+            if (*s == 0)
+                break;
+            if (*s != ',') {
+                printf(1, "Invalid cpu list\n");
+                return;
+            }
+        }
+    }
+    int res = set_affinity(pid, mask);
+
+    if (res < 0)
+        printf(1, "Error setting affinity\n");
+    else
+        printf(1, "Affinity has been set successfully\n");
+}
+
+void gang(int mem_id, char *mode)
+{
+    if (strcmp(mode, "on") != 0 && strcmp(mode, "off") != 0) {
+        printf(1, "Invalid params\n");
+        return;
+    }
+    int res = set_gang(mem_id, strcmp(mode, "on") == 0);
+
+    if (res < 0)
+        printf(1, "Error setting gang scheduling\n");
+    else
+        printf(1, "Gang scheduling has been set successfully\n");
+}
+
+void group(int pid, int gid)
+{
+    int res = set_group(pid, gid);
+
+    if (res < 0)
+        printf(1, "Error setting group\n");
+    else
+        printf(1, "Group has been set successfully\n");
+}
+
+void quota(int gid, int quota_ms, int period_ms)
+{
+    int res = set_group_quota(gid, quota_ms, period_ms);
+
+    if (res < 0)
+        printf(1, "Error setting quota\n");
+    else
+        printf(1, "Quota has been set successfully\n");
+}
+
 int main(int argc, char *argv[])
 {
     if (argc < 2) {
@@ -71,13 +228,69 @@ int main(int argc, char *argv[])
         } 
         change_queue(atoi(argv[2]), atoi(argv[3]));
     }
-    else if (!strcmp(argv[1], "set_sjf_param") == 0) {
+    else if (strcmp(argv[1], "set_sjf_param") == 0) {
         if (argc < 5) {
             help();
             exit();
         }
         set_sjf_parameters(atoi(argv[2]), atoi(argv[3]), atoi(argv[4]));
     }
+    else if (strcmp(argv[1], "predict") == 0) {
+        if (argc < 5) {
+            help();
+            exit();
+        }
+        set_prediction(atoi(argv[2]), argv[3], atoi(argv[4]));
+    }
+    else if (strcmp(argv[1], "tune") == 0) {
+        if (argc < 9) {
+            help();
+            exit();
+        }
+        tune(argv[2], &argv[3]);
+    }
+    else if (strcmp(argv[1], "set_tickets") == 0) {
+        if (argc < 4) {
+            help();
+            exit();
+        }
+        set_process_tickets(atoi(argv[2]), atoi(argv[3]));
+    }
+    else if (strcmp(argv[1], "edf") == 0) {
+        if (argc < 6) {
+            help();
+            exit();
+        }
+        set_edf(atoi(argv[2]), atoi(argv[3]), atoi(argv[4]), atoi(argv[5]));
+    }
+    else if (strcmp(argv[1], "affinity") == 0) {
+        if (argc < 4) {
+            help();
+            exit();
+        }
+        affinity(atoi(argv[2]), argv[3]);
+    }
+    else if (strcmp(argv[1], "gang") == 0) {
+        if (argc < 4) {
+            help();
+            exit();
+        }
+        gang(atoi(argv[2]), argv[3]);
+    }
+    else if (strcmp(argv[1], "group") == 0) {
+        if (argc < 4) {
+            help();
+            exit();
+        }
+        group(atoi(argv[2]), atoi(argv[3]));
+    }
+    else if (strcmp(argv[1], "quota") == 0) {
+        if (argc < 5) {
+            help();
+            exit();
+        }
+        quota(atoi(argv[2]), atoi(argv[3]), atoi(argv[4]));
+    }
     else {
         help();
         exit();
@@ -52,6 +52,8 @@ struct backcmd {
 int fork1(void);  // Fork but panics on failure.
 void panic(char*);
 struct cmd *parsecmd(char*);
+void freecmd(struct cmd*);
+int parseerr;     // Set by parsecmd() on a syntax error
 
 // Execute cmd.  Never returns.
 void
@@ -132,6 +134,94 @@ runcmd(struct cmd *cmd)
   exit();
 }
 
+// Is cmd a program, with at most MAXARGS redirections, that
+// spawn() can start without a copy of the shell?
+int
+spawnable(struct cmd *cmd)
+{
+  struct execcmd *ecmd;
+  int n = 0;
+
+  for(; cmd && cmd->type == REDIR; n++)
+    cmd = ((struct redircmd*)cmd)->cmd;
+  if(cmd == 0 || cmd->type != EXEC || n > MAXARGS)
+    return 0;
+  ecmd = (struct execcmd*)cmd;
+  return ecmd->argv[0] != 0 && strcmp(ecmd->argv[0], "history") != 0;
+}
+
+// Spawn the spawnable cmd after the nact actions in act, which
+// has room for as many more as cmd has redirections.  Returns
+// the number of processes started.
+int
+spawn1(struct cmd *cmd, struct spawnaction *act, int nact)
+{
+  int fd, fds[MAXARGS], nfds = 0, pid;
+  struct execcmd *ecmd;
+  struct redircmd *rcmd;
+
+  // Open redirected files here and move them into place in the
+  // child, outermost first, as runcmd() would.
+  while(cmd->type == REDIR){
+    rcmd = (struct redircmd*)cmd;
+    if((fd = open(rcmd->file, rcmd->mode)) < 0){
+      printf(2, "open %s failed\n", rcmd->file);
+      pid = -1;
+      goto done;
+    }
+    fds[nfds++] = fd;
+    act[nact].op = SPAWN_DUP2;
+    act[nact].fd = fd;
+    act[nact++].newfd = rcmd->fd;
+    act[nact].op = SPAWN_CLOSE;
+    act[nact++].fd = fd;
+    cmd = rcmd->cmd;
+  }
+  ecmd = (struct execcmd*)cmd;
+  if((pid = spawn(ecmd->argv[0], ecmd->argv, act, nact)) < 0)
+    printf(2, "exec %s failed\n", ecmd->argv[0]);
+done:
+  while(nfds > 0)
+    close(fds[--nfds]);
+  return pid < 0 ? 0 : 1;
+}
+
+// Start cmd with spawn() if it is a program, possibly with
+// redirections, or a pipe between two.  Returns the number of
+// processes to wait for, or -1 if cmd needs runcmd() in a
+// forked shell.
+int
+spawncmd(struct cmd *cmd)
+{
+  int p[2], n;
+  struct pipecmd *pcmd;
+  struct spawnaction act[3 + 2*MAXARGS];
+
+  if(spawnable(cmd))
+    return spawn1(cmd, act, 0);
+  if(cmd == 0 || cmd->type != PIPE)
+    return -1;
+  pcmd = (struct pipecmd*)cmd;
+  if(!spawnable(pcmd->left) || !spawnable(pcmd->right))
+    return -1;
+  if(pipe(p) < 0)
+    panic("pipe");
+  act[0].op = SPAWN_DUP2;
+  act[0].fd = p[1];
+  act[0].newfd = 1;
+  act[1].op = SPAWN_CLOSE;
+  act[1].fd = p[0];
+  act[2].op = SPAWN_CLOSE;
+  act[2].fd = p[1];
+  n = spawn1(pcmd->left, act, 3);
+  act[0].fd = p[0];
+  act[0].newfd = 0;
+  n += spawn1(pcmd->right, act, 3);
+  close(p[0]);
+  close(p[1]);
+  return n;
+}
+
 int
 getcmd(char *buf, int nbuf)
 {
@@ -147,7 +237,8 @@ int
 main(void)
 {
   static char buf[100];
-  int fd;
+  int fd, n;
+  struct cmd *cmd;
 
   // Ensure that three file descriptors are open.
   while((fd = open("console", O_RDWR)) >= 0){
@@ -166,9 +257,23 @@ main(void)
         printf(2, "cannot cd %s\n", buf+3);
       continue;
     }
+    // Start simple commands and pipelines without forking.
+    cmd = parsecmd(buf);
+    if(parseerr){
+      parseerr = 0;
+      freecmd(cmd);
+      continue;
+    }
+    if((n = spawncmd(cmd)) >= 0){
+      while(n-- > 0)
+        wait();
+      freecmd(cmd);
+      continue;
+    }
     if(fork1() == 0)
-      runcmd(parsecmd(buf));
+      runcmd(cmd);
     wait();
+    freecmd(cmd);
   }
   exit();
 }
@@ -326,6 +431,14 @@ struct cmd *parsepipe(char**, char*);
 struct cmd *parseexec(char**, char*);
 struct cmd *nulterminate(struct cmd*);
 
+// Report a syntax error.  The shell runs nothing of the line.
+void
+syntax(char *msg)
+{
+  printf(2, "%s\n", msg);
+  parseerr = 1;
+}
+
 struct cmd*
 parsecmd(char *s)
 {
@@ -337,7 +450,7 @@ parsecmd(char *s)
   peek(&s, es, "");
   if(s != es){
     printf(2, "leftovers: %s\n", s);
-    panic("syntax");
+    syntax("syntax");
   }
   nulterminate(cmd);
   return cmd;
@@ -381,8 +494,10 @@ parseredirs(struct cmd *cmd, char **ps, char *es)
 
   while(peek(ps, es, "<>")){
     tok = gettoken(ps, es, 0, 0);
-    if(gettoken(ps, es, &q, &eq) != 'a')
-      panic("missing file for redirection");
+    if(gettoken(ps, es, &q, &eq) != 'a'){
+      syntax("missing file for redirection");
+      break;
+    }
     switch(tok){
     case '<':
       cmd = redircmd(cmd, q, eq, O_RDONLY, 0);
@@ -407,8 +522,10 @@ parseblock(char **ps, char *es)
     panic("parseblock");
   gettoken(ps, es, 0, 0);
   cmd = parseline(ps, es);
-  if(!peek(ps, es, ")"))
-    panic("syntax - missing )");
+  if(!peek(ps, es, ")")){
+    syntax("syntax - missing )");
+    return cmd;
+  }
   gettoken(ps, es, 0, 0);
   cmd = parseredirs(cmd, ps, es);
   return cmd;
@@ -433,13 +550,18 @@ parseexec(char **ps, char *es)
   while(!peek(ps, es, "|)&;")){
     if((tok=gettoken(ps, es, &q, &eq)) == 0)
       break;
-    if(tok != 'a')
-      panic("syntax");
+    if(tok != 'a'){
+      syntax("syntax");
+      break;
+    }
     cmd->argv[argc] = q;
     cmd->eargv[argc] = eq;
     argc++;
-    if(argc >= MAXARGS)
-      panic("too many args");
+    if(argc >= MAXARGS){
+      syntax("too many args");
+      argc--;
+      break;
+    }
     ret = parseredirs(ret, ps, es);
   }
   cmd->argv[argc] = 0;
@@ -493,3 +615,32 @@ nulterminate(struct cmd *cmd)
   }
   return cmd;
 }
+
+// Free a command parsed by parsecmd().
+void
+freecmd(struct cmd *cmd)
+{
+  if(cmd == 0)
+    return;
+
+  switch(cmd->type){
+  case REDIR:
+    freecmd(((struct redircmd*)cmd)->cmd);
+    break;
+
+  case PIPE:
+    freecmd(((struct pipecmd*)cmd)->left);
+    freecmd(((struct pipecmd*)cmd)->right);
+    break;
+
+  case LIST:
+    freecmd(((struct listcmd*)cmd)->left);
+    freecmd(((struct listcmd*)cmd)->right);
+    break;
+
+  case BACK:
+    freecmd(((struct backcmd*)cmd)->cmd);
+    break;
+  }
+  free(cmd);
+}
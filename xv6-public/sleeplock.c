@@ -17,6 +17,8 @@ initsleeplock(struct sleeplock *lk, char *name)
   lk->name = name;
   lk->locked = 0;
   lk->pid = 0;
+  lk->proc = 0;
+  lk->boosted = 0;
 }
 
 void
@@ -24,10 +26,13 @@ acquiresleep(struct sleeplock *lk)
 {
   acquire(&lk->lk);
   while (lk->locked) {
+    // Lend the holder our class while we wait for it.
+    lk->boosted = inherit_priority(lk->proc, myproc(), lk->boosted);
     sleep(lk, &lk->lk);
   }
   lk->locked = 1;
   lk->pid = myproc()->pid;
+  lk->proc = myproc();
   release(&lk->lk);
 }
 
@@ -35,8 +40,13 @@ void
 releasesleep(struct sleeplock *lk)
 {
   acquire(&lk->lk);
+  if (lk->boosted) {
+    lk->boosted = 0;
+    end_inheritance(lk->proc);
+  }
   lk->locked = 0;
   lk->pid = 0;
+  lk->proc = 0;
   wakeup(lk);
   release(&lk->lk);
 }
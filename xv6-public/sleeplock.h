@@ -2,6 +2,8 @@
 struct sleeplock {
   uint locked;       // Is the lock held?
   struct spinlock lk; // spinlock protecting this sleep lock
+  struct proc *proc; // Holder, for priority inheritance
+  int boosted;       // Has a waiter boosted the holder?
   
   // For debugging:
   char *name;        // Name of lock.
@@ -28,6 +28,8 @@ fetchint(uint addr, int *ip)
 
   if(addr >= curproc->sz || addr+4 > curproc->sz)
     return -1;
+  if(faultuvm(addr, 4) < 0)
+    return -1;
   *ip = *(int*)(addr);
   return 0;
 }
@@ -59,6 +61,9 @@ fetchstr(uint addr, char **pp)
   *pp = (char*)addr;
   ep = (char*)curproc->sz;
   for(s = *pp; s < ep; s++){
+    // Page in each page before scanning it.
+    if((s == *pp || (uint)s % PGSIZE == 0) && faultuvm((uint)s, 1) < 0)
+      return -1;
     if(*s == 0)
       return s - *pp;
   }
@@ -85,6 +90,8 @@ argptr(int n, char **pp, int size)
     return -1;
   if(size < 0 || (uint)i >= curproc->sz || (uint)i+size > curproc->sz)
     return -1;
+  if(faultuvm((uint)i, size) < 0)
+    return -1;
   *pp = (char*)i;
   return 0;
 }
@@ -135,6 +142,19 @@ extern int sys_getsyscallcount(void);
 extern int sys_testreentrantlock(void);
 extern int sys_open_shared_memory(void);
 extern int sys_close_shared_memory(void);
+extern int sys_set_burst_prediction(void);
+extern int sys_tune_scheduler(void);
+extern int sys_set_tickets(void);
+extern int sys_transfer_tickets(void);
+extern int sys_set_edf_params(void);
+extern int sys_set_affinity(void);
+extern int sys_getschedstat(void);
+extern int sys_yield_to(void);
+extern int sys_getcputime(void);
+extern int sys_set_gang(void);
+extern int sys_set_group(void);
+extern int sys_set_group_quota(void);
+extern int sys_spawn(void);
 
 static int (*syscalls[])(void) = {
 [SYS_fork]    sys_fork,
@@ -169,13 +189,33 @@ static int (*syscalls[])(void) = {
 [SYS_getsyscallcount] sys_getsyscallcount,
 [SYS_testreentrantlock] sys_testreentrantlock,
 [SYS_open_shared_memory]  sys_open_shared_memory,
-[SYS_close_shared_memory]  sys_close_shared_memory
+[SYS_close_shared_memory]  sys_close_shared_memory,
+[SYS_set_burst_prediction] sys_set_burst_prediction,
+[SYS_tune_scheduler] sys_tune_scheduler,
+[SYS_set_tickets] sys_set_tickets,
+[SYS_transfer_tickets] sys_transfer_tickets,
+[SYS_set_edf_params] sys_set_edf_params,
+[SYS_set_affinity] sys_set_affinity,
+[SYS_getschedstat] sys_getschedstat,
+[SYS_yield_to] sys_yield_to,
+[SYS_getcputime] sys_getcputime,
+[SYS_set_gang] sys_set_gang,
+[SYS_set_group] sys_set_group,
+[SYS_set_group_quota] sys_set_group_quota,
+[SYS_spawn] sys_spawn,
 };
 
 const char *syscall_names[] = {"fork", "exit", "wait", "pipe", "read", "kill", "exec", "fstat", "chdir", "dup", 
                               "getpid", "sbrk", "sleep", "uptime", "open", "write", "mknod", "unlink", "link", 
                               "mkdir", "close", "create_palindrome", "move_file", "sort_syscalls", 
-                              "get_most_invoked_syscall", "list_all_processes"};
+                              "get_most_invoked_syscall", "list_all_processes", "change_scheduling_queue",
+                              "print_processes_info", "set_sjf_params", "getsyscallcount",
+                              "testreentrantlock", "open_shared_memory", "close_shared_memory",
+                              "set_burst_prediction", "tune_scheduler", "set_tickets",
+                              "transfer_tickets", "set_edf_params", "set_affinity",
+                              "getschedstat", "yield_to", "getcputime",
+                              "set_gang", "set_group", "set_group_quota",
+                              "spawn"};
 
 int record_syscall(struct proc *p, int num) {
   for (int i = 0; i < MAX_SYSCALLS; i++) {
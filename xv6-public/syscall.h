@@ -31,4 +31,17 @@
 #define SYS_getsyscallcount 30
 #define SYS_testreentrantlock 31
 #define SYS_open_shared_memory 32
-#define SYS_close_shared_memory  33
\ No newline at end of file
+#define SYS_close_shared_memory  33
+#define SYS_set_burst_prediction 34
+#define SYS_tune_scheduler 35
+#define SYS_set_tickets 36
+#define SYS_transfer_tickets 37
+#define SYS_set_edf_params 38
+#define SYS_set_affinity 39
+#define SYS_getschedstat 40
+#define SYS_yield_to 41
+#define SYS_getcputime 42
+#define SYS_set_gang 43
+#define SYS_set_group 44
+#define SYS_set_group_quota 45
+#define SYS_spawn 46
\ No newline at end of file
@@ -419,6 +419,35 @@ sys_exec(void)
   return exec(path, argv);
 }
 
+int
+sys_spawn(void)
+{
+  char *path, *argv[MAXARG];
+  struct spawnaction *act;
+  int i, nact;
+  uint uargv, uarg;
+
+  if(argstr(0, &path) < 0 || argint(1, (int*)&uargv) < 0 ||
+     argint(3, &nact) < 0 || nact < 0 || nact > 2*NOFILE ||
+     argptr(2, (void*)&act, nact*sizeof(act[0])) < 0){
+    return -1;
+  }
+  memset(argv, 0, sizeof(argv));
+  for(i=0;; i++){
+    if(i >= NELEM(argv))
+      return -1;
+    if(fetchint(uargv+4*i, (int*)&uarg) < 0)
+      return -1;
+    if(uarg == 0){
+      argv[i] = 0;
+      break;
+    }
+    if(fetchstr(uarg, &argv[i]) < 0)
+      return -1;
+  }
+  return spawn(path, argv, act, nact);
+}
+
 int
 sys_pipe(void)
 {
@@ -576,6 +605,7 @@ sys_move_file(void)
       end_op();
       return -1;
     }
+    cond_resched();
   }
 
 
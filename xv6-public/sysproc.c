@@ -6,6 +6,7 @@
 #include "memlayout.h"
 #include "mmu.h"
 #include "proc.h"
+#include "schedstat.h"
 #include "syscall.h"
 #include "spinlock.h"
 
@@ -134,7 +135,7 @@ int sys_change_scheduling_queue(void)
   int queue_number, pid;
   if(argint(0, &pid) < 0 || argint(1, &queue_number) < 0)
     return -1;
-  if(queue_number < ROUND_ROBIN || queue_number > FCFS)
+  if(queue_number < ROUND_ROBIN || queue_number > STRIDE)
     return -1;
   return change_queue(pid, queue_number);
 }
@@ -154,6 +155,124 @@ int sys_set_sjf_params(void)
   return set_sjf_params(pid, priority_ratio, arrival_time_ratio);
 }
 
+int sys_set_burst_prediction(void)
+{
+  int pid, enabled, alpha;
+  if(argint(0, &pid) < 0 || argint(1, &enabled) < 0 || argint(2, &alpha) < 0)
+    return -1;
+  if(alpha < 0 || alpha > 100)
+    return -1;
+
+  return set_burst_prediction(pid, enabled, alpha);
+}
+
+int sys_tune_scheduler(void)
+{
+  int cpu, rr_share, sjf_share, fcfs_share, stride_share;
+  int rr_quantum, aging_threshold;
+  if(argint(0, &cpu) < 0 || argint(1, &rr_share) < 0 ||
+     argint(2, &sjf_share) < 0 || argint(3, &fcfs_share) < 0 ||
+     argint(4, &stride_share) < 0 || argint(5, &rr_quantum) < 0 ||
+     argint(6, &aging_threshold) < 0)
+    return -1;
+
+  return tune_scheduler(cpu, rr_share, sjf_share, fcfs_share,
+                        stride_share, rr_quantum, aging_threshold);
+}
+
+int sys_set_edf_params(void)
+{
+  int pid, runtime, period, deadline;
+  if(argint(0, &pid) < 0 || argint(1, &runtime) < 0 ||
+     argint(2, &period) < 0 || argint(3, &deadline) < 0)
+    return -1;
+
+  return set_edf_params(pid, runtime, period, deadline);
+}
+
+int sys_set_affinity(void)
+{
+  int pid, mask;
+  if(argint(0, &pid) < 0 || argint(1, &mask) < 0)
+    return -1;
+
+  return set_affinity(pid, (uint)mask);
+}
+
+int sys_yield_to(void)
+{
+  int pid;
+  if(argint(0, &pid) < 0)
+    return -1;
+
+  return yield_to(pid);
+}
+
+int sys_getcputime(void)
+{
+  int pid;
+  struct proctime *t;
+  if(argint(0, &pid) < 0 || argptr(1, (void*)&t, sizeof(*t)) < 0)
+    return -1;
+
+  return getcputime(pid, t);
+}
+
+int sys_set_gang(void)
+{
+  int mem_id, enabled;
+  if(argint(0, &mem_id) < 0 || argint(1, &enabled) < 0)
+    return -1;
+
+  return set_gang(mem_id, enabled);
+}
+
+int sys_set_group(void)
+{
+  int pid, gid;
+  if(argint(0, &pid) < 0 || argint(1, &gid) < 0)
+    return -1;
+
+  return set_group(pid, gid);
+}
+
+int sys_set_group_quota(void)
+{
+  int gid, quota_ms, period_ms;
+  if(argint(0, &gid) < 0 || argint(1, &quota_ms) < 0 ||
+     argint(2, &period_ms) < 0)
+    return -1;
+
+  return set_group_quota(gid, quota_ms, period_ms);
+}
+
+int sys_getschedstat(void)
+{
+  struct schedstat *st;
+  if(argptr(0, (void*)&st, sizeof(*st)) < 0)
+    return -1;
+
+  return getschedstat(st);
+}
+
+int sys_set_tickets(void)
+{
+  int pid, tickets;
+  if(argint(0, &pid) < 0 || argint(1, &tickets) < 0)
+    return -1;
+
+  return set_tickets(pid, tickets);
+}
+
+int sys_transfer_tickets(void)
+{
+  int pid, amount;
+  if(argint(0, &pid) < 0 || argint(1, &amount) < 0)
+    return -1;
+
+  return transfer_tickets(pid, amount);
+}
+
 int sys_getsyscallcount(void)
 {
   int i, sum_count = 0, total_count;
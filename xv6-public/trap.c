@@ -13,6 +13,8 @@ struct gatedesc idt[256];
 extern uint vectors[];  // in vectors.S: array of 256 entry pointers
 struct spinlock tickslock;
 uint ticks;
+uint tsc_per_tick;        // TSC cycles per tick, running average
+static uint64 tick_tsc;   // TSC at the last tick
 
 void
 tvinit(void)
@@ -36,6 +38,14 @@ idtinit(void)
 void
 trap(struct trapframe *tf)
 {
+  int gangcall = 0;
+  uint va;
+
+  // Time spent in user mode ends here, and kernel time when we
+  // return to it.
+  if(myproc() && (tf->cs&3) == DPL_USER)
+    account(myproc(), 1);
+
   if(tf->trapno == T_SYSCALL){
     if(myproc()->killed)
       exit();
@@ -43,21 +53,32 @@ trap(struct trapframe *tf)
     syscall();
     if(myproc()->killed)
       exit();
+    account(myproc(), 0);
     return;
   }
-  int temp_tick;
   switch(tf->trapno){
   case T_IRQ0 + IRQ_TIMER:
     if(cpuid() == 0){
       acquire(&tickslock);
+      uint64 now = rdtsc();
+      if(tick_tsc)
+        tsc_per_tick = tsc_per_tick ? (7*tsc_per_tick + (uint)(now - tick_tsc)) / 8 :
+                                      (uint)(now - tick_tsc);
+      tick_tsc = now;
       ticks++;
-      temp_tick = ticks;
       wakeup(&ticks);
       release(&tickslock);
-      aging_process(temp_tick);
     }
+    mycpu()->timer_ticks++;
+    if(mycpu()->idle)
+      mycpu()->idle_ticks++;
     lapiceoi();
     break;
+  case T_IRQ0 + IRQ_RESCHED:
+    // Brings a halted CPU out of hlt, and carries gang calls.
+    lapiceoi();
+    gangcall = gang_call();
+    break;
   case T_IRQ0 + IRQ_IDE:
     ideintr();
     lapiceoi();
@@ -80,6 +101,21 @@ trap(struct trapframe *tf)
     lapiceoi();
     break;
 
+  case T_PGFLT:
+    // Copy-on-write, or the first touch of a heap or program
+    // page; anything else is an error, handled below.  Reading
+    // a program page sleeps on the disk, so turn interrupts back
+    // on, as a system call runs, if the faulting code had them
+    // on and so holds no spinlock.  The interrupt gate turned
+    // them off.  Read %cr2 first: once interrupts are on, we may
+    // be switched out and another fault may overwrite it.
+    va = rcr2();
+    if(tf->eflags & FL_IF)
+      sti();
+    if(pagefault(va) == 0)
+      break;
+    // fall through
+
   //PAGEBREAK: 13
   default:
     if(myproc() == 0 || (tf->cs&3) == 0){
@@ -104,20 +140,18 @@ trap(struct trapframe *tf)
 
   // Force process to give up CPU on clock tick.
   // If interrupts were on while locks held, would need to check nlock.
-  if(myproc() && myproc()->state == RUNNING && tf->trapno == T_IRQ0+IRQ_TIMER) {
-    myproc()->consecutive_time += 1;
-    myproc()->sched_info.last_run = ticks;
-    struct cpu *c = mycpu();
-    int time_periode = (c->cpu_ticks % 60) + 1;
-    c->cpu_ticks++;
-    if((myproc()->sched_info.queue == ROUND_ROBIN && myproc()->consecutive_time >= 5) ||
-      (time_periode == 30 || time_periode == 50 || time_periode == 60)) {
-      // cprintf("tick = %d cpu_get_time = %d process pid = %d queue = %s\n",ticks, myproc()->sched_info.get_cpu_time, myproc()->pid, myproc()->sched_info.queue);
-      yield();
-    }
-  }
+  if(myproc() && myproc()->state == RUNNING && tf->trapno == T_IRQ0+IRQ_TIMER &&
+     timer_tick(mycpu(), myproc()))
+    yield();
+
+  // Make way for a gang member this CPU was called to run.
+  if(gangcall && myproc() && myproc()->state == RUNNING)
+    yield();
 
   // Check if the process has been killed since we yielded
   if(myproc() && myproc()->killed && (tf->cs&3) == DPL_USER)
     exit();
+
+  if(myproc() && (tf->cs&3) == DPL_USER)
+    account(myproc(), 0);
 }
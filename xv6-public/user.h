@@ -1,5 +1,8 @@
 struct stat;
+struct schedstat;
+struct proctime;
 struct rtcdate;
+struct spawnaction;
 
 // system calls
 int fork(void);
@@ -35,6 +38,19 @@ void getsyscallcount(void);
 int testreentrantlock(void);
 int open_shared_memory(int);
 int close_shared_memory(void*);
+int set_burst_prediction(int, int, int);
+int tune_scheduler(int, int, int, int, int, int, int);
+int set_tickets(int, int);
+int transfer_tickets(int, int);
+int set_edf_params(int, int, int, int);
+int set_affinity(int, uint);
+int getschedstat(struct schedstat*);
+int yield_to(int);
+int getcputime(int, struct proctime*);
+int set_gang(int, int);
+int set_group(int, int);
+int set_group_quota(int, int, int);
+int spawn(char*, char**, struct spawnaction*, int);
 
     
 // ulib.c
@@ -7,6 +7,9 @@
 #include "proc.h"
 #include "elf.h"
 #include "spinlock.h"
+#include "sleeplock.h"
+#include "fs.h"
+#include "file.h"
 
 extern char data[];  // defined by kernel.ld
 pde_t *kpgdir;  // for use in scheduler()
@@ -312,39 +315,294 @@ clearpteu(pde_t *pgdir, char *uva)
 }
 
 // Given a parent process's page table, create a copy
-// of it for a child.
+// of it for a child.  The pages are not copied but shared,
+// and writable ones become read-only copy-on-write in both;
+// pagefault() copies a page when either writes to it.
 pde_t*
 copyuvm(pde_t *pgdir, uint sz)
 {
   pde_t *d;
   pte_t *pte;
   uint pa, i, flags;
-  char *mem;
 
   if((d = setupkvm()) == 0)
     return 0;
   for(i = 0; i < sz; i += PGSIZE){
-    if((pte = walkpgdir(pgdir, (void *) i, 0)) == 0)
-      panic("copyuvm: pte should exist");
+    // Heap pages not yet touched stay that way in the child.
+    if((pte = walkpgdir(pgdir, (void *) i, 0)) == 0){
+      i = PGADDR(PDX(i) + 1, 0, 0) - PGSIZE;
+      continue;
+    }
     if(!(*pte & PTE_P))
-      panic("copyuvm: page not present");
+      continue;
+    if(*pte & PTE_W)
+      *pte = (*pte & ~PTE_W) | PTE_COW;
     pa = PTE_ADDR(*pte);
     flags = PTE_FLAGS(*pte);
-    if((mem = kalloc()) == 0)
+    if(mappages(d, (void*)i, PGSIZE, pa, flags) < 0)
       goto bad;
-    memmove(mem, (char*)P2V(pa), PGSIZE);
-    if(mappages(d, (void*)i, PGSIZE, V2P(mem), flags) < 0) {
-      kfree(mem);
-      goto bad;
-    }
+    kref(P2V(pa));
+    cond_resched();
   }
+  // The parent may have cached its old, writable entries.
+  if(myproc() && myproc()->pgdir == pgdir)
+    lcr3(V2P(pgdir));
   return d;
 
 bad:
+  if(myproc() && myproc()->pgdir == pgdir)
+    lcr3(V2P(pgdir));
   freevm(d);
   return 0;
 }
 
+// Give pgdir its own writable copy of the copy-on-write page
+// at va, or just make it writable if no other page table still
+// shares it.  Returns -1 if the page is not copy-on-write or
+// memory is short.
+static int
+cowcopy(pde_t *pgdir, uint va)
+{
+  pte_t *pte;
+  char *old, *mem;
+
+  if((pte = walkpgdir(pgdir, (void*)va, 0)) == 0 ||
+     (*pte & (PTE_P|PTE_U|PTE_COW)) != (PTE_P|PTE_U|PTE_COW))
+    return -1;
+  old = P2V(PTE_ADDR(*pte));
+  if(krefs(old) == 1){
+    *pte = (*pte & ~PTE_COW) | PTE_W;
+    return 0;
+  }
+  if((mem = kalloc()) == 0)
+    return -1;
+  memmove(mem, old, PGSIZE);
+  *pte = V2P(mem) | (PTE_FLAGS(*pte) & ~PTE_COW) | PTE_W;
+  kfree(old);
+  return 0;
+}
+
+// Pages of programs, read in by pagein(), that every process
+// running the same executable maps instead of reading its own
+// copy.  A page is found by its file offset and the file's dev,
+// inum and generation, which writing the file changes.  The
+// cache holds a reference to each page; pages in no page table
+// are freed when kalloc() runs out, and the least recently used
+// one is replaced when the cache is full.
+struct textpage {
+  uint dev;
+  uint inum;
+  uint gen;
+  uint off;                 // File offset of the page
+  uint n;                   // Bytes of file data; the rest is zero
+  char *mem;                // 0 if the slot is free
+  uint used;                // textcache.clock when last used
+};
+
+struct {
+  struct spinlock lock;
+  uint clock;
+  struct textpage page[NTEXTPAGE];
+} textcache;
+
+void
+textinit(void)
+{
+  initlock(&textcache.lock, "textcache");
+}
+
+// The cached page of ip at off with n bytes of it, with a
+// reference added for the caller, or 0.  Caller must hold
+// ip->lock.
+static char*
+textget(struct inode *ip, uint off, uint n)
+{
+  struct textpage *t;
+  char *mem;
+
+  mem = 0;
+  acquire(&textcache.lock);
+  for(t = textcache.page; t < textcache.page + NTEXTPAGE; t++){
+    if(t->mem && t->dev == ip->dev && t->inum == ip->inum &&
+       t->gen == ip->gen && t->off == off && t->n == n){
+      t->used = ++textcache.clock;
+      kref(t->mem);
+      mem = t->mem;
+      break;
+    }
+  }
+  release(&textcache.lock);
+  return mem;
+}
+
+// Cache mem, just read from ip at off.  Caller must hold ip->lock.
+static void
+textput(struct inode *ip, uint off, uint n, char *mem)
+{
+  struct textpage *t, *victim;
+
+  victim = 0;
+  acquire(&textcache.lock);
+  for(t = textcache.page; t < textcache.page + NTEXTPAGE; t++){
+    if(t->mem == 0){
+      victim = t;
+      break;
+    }
+    if(victim == 0 || t->used < victim->used)
+      victim = t;
+  }
+  if(victim->mem)
+    kfree(victim->mem);
+  victim->dev = ip->dev;
+  victim->inum = ip->inum;
+  victim->gen = ip->gen;
+  victim->off = off;
+  victim->n = n;
+  victim->mem = mem;
+  victim->used = ++textcache.clock;
+  kref(mem);
+  release(&textcache.lock);
+}
+
+// Free the cached pages that no process maps, for kalloc()
+// when memory runs out.  Returns how many were freed.
+int
+textreclaim(void)
+{
+  struct textpage *t;
+  int n;
+
+  n = 0;
+  acquire(&textcache.lock);
+  for(t = textcache.page; t < textcache.page + NTEXTPAGE; t++){
+    if(t->mem && krefs(t->mem) == 1){
+      kfree(t->mem);
+      t->mem = 0;
+      n++;
+    }
+  }
+  release(&textcache.lock);
+  return n;
+}
+
+// The segment of p's program that has file data for page va.
+static struct segment*
+fileseg(struct proc *p, uint va)
+{
+  struct segment *s;
+
+  for(s = p->seg; s < p->seg + p->nseg; s++)
+    if(va >= s->va && va - s->va < s->filesz)
+      return s;
+  return 0;
+}
+
+// Map a page at va in p, below p->sz, if it has not been touched
+// yet: a page of p's executable if va is in one of its program
+// segments (see loaduser()), zeroed otherwise, as for the heap,
+// which growproc() only reserves.  Program pages come from the
+// text cache, shared read-only, or copy-on-write if the segment
+// is writable.  Returns 0 if it was, 1 if va is mapped already,
+// -1 if it cannot be.
+static int
+pagein(struct proc *p, uint va)
+{
+  pte_t *pte;
+  struct segment *s;
+  char *mem;
+  uint n, off, perm;
+
+  if(va >= p->sz)
+    return -1;
+  if((pte = walkpgdir(p->pgdir, (void*)va, 0)) != 0 && (*pte & PTE_P))
+    return 1;
+  s = fileseg(p, va);
+  if(s){
+    // Reading the file sleeps, which must not happen with
+    // interrupts off: a spinlock is held, or trap() did not
+    // turn them back on.  argptr() pages in system call
+    // buffers before any lock is taken.
+    if(!(readeflags() & FL_IF))
+      return -1;
+  }
+  if(s == 0){
+    if((mem = kalloc()) == 0)
+      return -1;
+    memset(mem, 0, PGSIZE);
+    perm = PTE_W|PTE_U;
+  } else {
+    off = s->off + (va - s->va);
+    n = s->filesz - (va - s->va);
+    if(n > PGSIZE)
+      n = PGSIZE;
+    ilock(p->exe);
+    if((mem = textget(p->exe, off, n)) == 0){
+      if((mem = kalloc()) == 0){
+        iunlock(p->exe);
+        return -1;
+      }
+      memset(mem, 0, PGSIZE);
+      if(readi(p->exe, mem, off, n) != n){
+        iunlock(p->exe);
+        kfree(mem);
+        return -1;
+      }
+      textput(p->exe, off, n, mem);
+    }
+    iunlock(p->exe);
+    perm = PTE_U;
+    if(s->flags & ELF_PROG_FLAG_WRITE)
+      perm |= PTE_COW;
+  }
+  if(mappages(p->pgdir, (void*)va, PGSIZE, V2P(mem), perm) < 0){
+    kfree(mem);
+    return -1;
+  }
+  return 0;
+}
+
+// Handle a page fault at va in the current process, from user
+// mode or from the kernel using user memory.  Returns 0 if the
+// faulting access can be retried, -1 if it is an error.
+int
+pagefault(uint va)
+{
+  struct proc *p = myproc();
+  uint a;
+  int r;
+
+  if(p == 0 || va >= KERNBASE)
+    return -1;
+  va = PGROUNDDOWN(va);
+  if((r = pagein(p, va)) < 0)
+    return -1;
+  if(r == 1 && cowcopy(p->pgdir, va) < 0)
+    return -1;
+  // Read ahead the next few pages of a program segment, which
+  // code usually goes on to use.
+  if(r == 0 && fileseg(p, va))
+    for(a = va + PGSIZE; a < va + (PAGEIN_AHEAD+1)*PGSIZE && fileseg(p, a); a += PGSIZE)
+      if(pagein(p, a) < 0)
+        break;
+  lcr3(V2P(p->pgdir));
+  return 0;
+}
+
+// Map the untouched pages of the current process in [va, va+n),
+// so that the kernel can use them without faulting.
+// For system call arguments; returns -1 if memory is short.
+int
+faultuvm(uint va, uint n)
+{
+  struct proc *p = myproc();
+  uint a;
+
+  for(a = PGROUNDDOWN(va); a < va + n; a += PGSIZE)
+    if(pagein(p, a) < 0)
+      return -1;
+  return 0;
+}
+
 //PAGEBREAK!
 // Map user virtual address to kernel address.
 char*
@@ -353,7 +611,7 @@ uva2ka(pde_t *pgdir, char *uva)
   pte_t *pte;
 
   pte = walkpgdir(pgdir, uva, 0);
-  if((*pte & PTE_P) == 0)
+  if(pte == 0 || (*pte & PTE_P) == 0)
     return 0;
   if((*pte & PTE_U) == 0)
     return 0;
@@ -372,9 +630,17 @@ copyout(pde_t *pgdir, uint va, void *p, uint len)
   buf = (char*)p;
   while(len > 0){
     va0 = (uint)PGROUNDDOWN(va);
+    // Writes through the kernel mapping bypass page faults.
+    if(myproc() && myproc()->pgdir == pgdir && pagein(myproc(), va0) >= 0){
+      cowcopy(pgdir, va0);
+      lcr3(V2P(pgdir));
+    }
     pa0 = uva2ka(pgdir, (char*)va0);
     if(pa0 == 0)
       return -1;
+    // Nor may they change a shared program page.
+    if((*walkpgdir(pgdir, (char*)va0, 0) & PTE_W) == 0)
+      return -1;
     n = PGSIZE - (va - va0);
     if(n > len)
       n = len;
@@ -436,7 +702,7 @@ create_shared_memory(uint size, int given_index)
 int 
 get_shared_memory_index(int mem_id)
 {
-  if (mem_id < 0 || mem_id > NUM_SHARED_MEMORY) {
+  if (mem_id < 0 || mem_id >= NUM_SHARED_MEMORY) {
     return -1;
   }
 
@@ -488,7 +754,7 @@ get_least_index(void *current_address, struct proc *process)
 void* 
 open_shared_memory(int mem_id)
 {
-  if (mem_id < 0 || mem_id > NUM_SHARED_MEMORY) {
+  if (mem_id < 0 || mem_id >= NUM_SHARED_MEMORY) {
     return (void *)-1;
   }
 
@@ -580,6 +846,7 @@ open_shared_memory(int mem_id)
   }
 
   release(&SharedMemoryTable.lock);
+  gang_update(process);
   return virtual_address;
 }
 
@@ -654,6 +921,7 @@ close_shared_memory(void *shmaddr)
     }
 
     release(&SharedMemoryTable.lock);
+    gang_update(process);
     return 0;
   }
 
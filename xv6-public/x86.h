@@ -1,5 +1,7 @@
 // Routines to let C code use special x86 instructions.
+// The scheduler simulator, schedsim.c, supplies its own.
 
+#ifndef SCHEDSIM
 static inline uchar
 inb(ushort port)
 {
@@ -117,6 +119,15 @@ sti(void)
   asm volatile("sti");
 }
 
+// Enable interrupts and wait for one.  sti only takes effect
+// after the next instruction, so an interrupt that is already
+// pending is taken in the hlt rather than before it.
+static inline void
+sti_hlt(void)
+{
+  asm volatile("sti; hlt");
+}
+
 static inline uint
 xchg(volatile uint *addr, uint newval)
 {
@@ -130,6 +141,15 @@ xchg(volatile uint *addr, uint newval)
   return result;
 }
 
+// Read the time-stamp counter.
+static inline uint64
+rdtsc(void)
+{
+  uint lo, hi;
+  asm volatile("rdtsc" : "=a" (lo), "=d" (hi));
+  return ((uint64)hi << 32) | lo;
+}
+
 static inline uint
 rcr2(void)
 {
@@ -143,6 +163,7 @@ lcr3(uint val)
 {
   asm volatile("movl %0,%%cr3" : : "r" (val));
 }
+#endif
 
 //PAGEBREAK: 36
 // Layout of the trap frame built on the stack by the